@@ -13,6 +13,9 @@
  * (at your option) any later version.
  */
 
+#if defined(LIBABCM2PS) && !defined(HAVE_FUNOPEN)
+#define _GNU_SOURCE		/* fopencookie() */
+#endif
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
@@ -20,6 +23,11 @@
 #include <sys/stat.h>
 
 #include "abcm2ps.h"
+#ifdef LIBABCM2PS
+#include <setjmp.h>
+#include "libabcm2ps.h"
+#define main abcm2ps_main	/* the program is also in the library */
+#endif
 
 #ifdef HAVE_MMAP
 #include <unistd.h>
@@ -27,6 +35,12 @@
 #elif defined(linux)
 #include <unistd.h>
 #endif
+#if defined(unix) || defined(__unix__)
+#include <unistd.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#define HAVE_JOBS 1
+#endif
 
 /* -- global variables -- */
 
@@ -46,10 +60,16 @@ int epsf;			/* 1: EPSF, 2: SVG, 3: embedded ABC */
 int svg;			/* 1: SVG, 2: XHTML */
 int showerror;			/* show the errors */
 int pipeformat = 0;		/* format for bagpipes regardless of key */
+char *cachedir;			/* tune cache directory */
+static int tuneindex;		/* use the tune indexes ('-Y') */
 
 char outfn[FILENAME_MAX];	/* output file name */
 int file_initialized;		/* for output file */
 FILE *fout;			/* output file */
+FILE *fstdout;			/* stream of the output file '-' */
+void (*out_flush)(void);	/* end of page/tune on fstdout */
+FILE *out_ren;			/* renames of the output files (-J) */
+int out_id;			/* worker number (-J) */
 char *in_fname;			/* top level input file name */
 time_t mtime;			/* last modification time of the input file */
 static time_t fmtime;		/*	"	"	of all files */
@@ -67,11 +87,27 @@ static char *styd = DEFAULT_FDIR; /* format search directory */
 static int def_fmt_done = 0;	/* default format read */
 static struct SYMBOL notitle;
 
+#ifdef HAVE_JOBS
+/* parallel treatment of the ABC files or tunes ('-J') */
+static int njobs;		/* max number of worker processes */
+static int nrun;		/* number of running workers */
+static int job_first, job_last;	/* jobs not yet reported */
+static int job_max;		/* size of jobs[] */
+static struct job_s {
+	pid_t pid;
+	FILE *out, *err;	/* stdout and stderr of the worker */
+	FILE *ren;		/* renames of the output files */
+	int status;		/* exit status, -1 when running */
+} *jobs;
+static int job_fd[2] = {-1, -1}; /* stdout and stderr of a muted worker */
+static int server;		/* treat the requests from stdin ('-R') */
+#endif
+
 /* memory arena (for clrarena, lvlarena & getarena) */
 #define MAXAREAL 3		/* max area levels:
 				 * 0; global, 1: tune, 2: generation */
 #define AREANASZ 0x4000		/* standard allocation size */
-#define MAXAREANASZ 0x20000	/* biggest allocation size */
+#define BIGAREANASZ (AREANASZ / 4) /* own area above this size */
 static int str_level;		/* current arena level */
 static struct str_a {
 	struct str_a *n;	/* next area */
@@ -79,7 +115,15 @@ static struct str_a {
 	int	r;		/* remaining space in area */
 	int	sz;		/* size of str[] */
 	char	str[2];		/* start of memory area */
-} *str_r[MAXAREAL], *str_c[MAXAREAL];	/* root and current area pointers */
+} *str_r[MAXAREAL], *str_c[MAXAREAL],	/* root and current area pointers */
+  *str_b[MAXAREAL];			/* big areas, freed on clear */
+static struct {
+	size_t	used, max;	/* used memory and high-water mark */
+	size_t	big, bigmax;	/* memory in big areas */
+	int	nareas;		/* number of standard areas */
+	int	nbig;		/* number of big allocations */
+} str_st[MAXAREAL];		/* arena statistics */
+static int memreport;		/* display the arena statistics ('-W') */
 
 /* -- local functions -- */
 static void read_def_format(void);
@@ -139,58 +183,56 @@ FILE *open_file(char *fn,	/* file name */
 
 /* -- read a whole input file -- */
 /* return the real/full file name in tex_buf[] */
-static char *read_file(char *fn, char *ext)
+/* when the file is mapped in memory, its size is put in *p_mapsz,
+ * otherwise 0 */
+static char *read_file(char *fn, char *ext, size_t *p_mapsz)
 {
 	size_t fsize;
 	FILE *fin;
 	char *file;
+	struct stat sbuf;
 
-	if (*fn == '\0') {
-		strcpy(tex_buf, "stdin");
-		fsize = 0;
-		file = malloc(8192);
-		for (;;) {
-			int l;
-
-			l = fread(&file[fsize], 1, 8192, stdin);
-			fsize += l;
-			if (l != 8192)
-				break;
-			file = realloc(file, fsize + 8192);
-		}
-		if (ferror(stdin) != 0) {
-			free(file);
-			return 0;
-		}
-		if (fsize % 8192 == 0)
-			file = realloc(file, fsize + 2);
-		time(&fmtime);
-	} else {
-		struct stat sbuf;
+	*p_mapsz = 0;
+	fin = open_file(fn, ext, tex_buf);
+	if (!fin)
+		return NULL;
+	if (fseek(fin, 0L, SEEK_END) < 0) {
+		fclose(fin);
+		return NULL;
+	}
+	fsize = ftell(fin);
+	rewind(fin);
+	fstat(fileno(fin), &sbuf);
+	memcpy(&fmtime, &sbuf.st_mtime, sizeof fmtime);
 
-		fin = open_file(fn, ext, tex_buf);
-		if (!fin)
-			return NULL;
-		if (fseek(fin, 0L, SEEK_END) < 0) {
-			fclose(fin);
-			return NULL;
-		}
-		fsize = ftell(fin);
-		rewind(fin);
-		if ((file = malloc(fsize + 2)) == NULL) {
+#ifdef HAVE_MMAP
+	/* map the file when there is room for the trailing '\0'
+	 * in its last page (the end of the page is zero-filled)
+	 * the front end writes into the text only temporarily,
+	 * so the mapping is private */
+	if (fsize % sysconf(_SC_PAGESIZE) != 0
+	 && S_ISREG(sbuf.st_mode)) {
+		file = mmap(NULL, fsize, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE, fileno(fin), 0);
+		if (file != MAP_FAILED) {
 			fclose(fin);
-			return NULL;
+			*p_mapsz = fsize;
+			return file;
 		}
+	}
+#endif
 
-		if (fread(file, 1, fsize, fin) != fsize) {
-			fclose(fin);
-			free(file);
-			return NULL;
-		}
-		fstat(fileno(fin), &sbuf);
-		memcpy(&fmtime, &sbuf.st_mtime, sizeof fmtime);
+	if ((file = malloc(fsize + 2)) == NULL) {
 		fclose(fin);
+		return NULL;
+	}
+
+	if (fread(file, 1, fsize, fin) != fsize) {
+		fclose(fin);
+		free(file);
+		return NULL;
 	}
+	fclose(fin);
 	file[fsize] = '\0';
 	return file;
 }
@@ -200,6 +242,7 @@ static void treat_file(char *fn, char *ext)
 {
 	char *file;
 	char *abc_fn;
+	size_t mapsz;
 	int file_type, l;
 
 	/* initialize if not already done */
@@ -209,9 +252,21 @@ static void treat_file(char *fn, char *ext)
 			return;		// if xx.default.fmt, done
 	}
 
+	/* stdin is treated while it is read */
+	if (*fn == '\0') {
+		if (!quiet)
+			fprintf(strcmp(outfn, "-") == 0 ? stderr : stdout,
+				"File stdin\n");
+		time(&fmtime);
+		mtime = fmtime;
+		frontend_stream(stdin, "stdin");
+		clrarena(1);		/* clear previous tunes */
+		return;
+	}
+
 	/* read the file into memory */
 	/* the real/full file name is put in tex_buf[] */
-	if ((file = read_file(fn, ext)) == NULL) {
+	if ((file = read_file(fn, ext, &mapsz)) == NULL) {
 		if (strcmp(fn, "default.fmt") != 0) {
 			error(1, NULL, "Cannot read the input file '%s'", fn);
 #if defined(unix) || defined(__unix__)
@@ -235,11 +290,18 @@ static void treat_file(char *fn, char *ext)
 		file_type = FE_ABC;
 //		in_fname = abc_fn;
 		mtime = fmtime;
+		if (tuneindex)
+			tune_index((unsigned char *) file, abc_fn);
 	}
 
 	frontend((unsigned char *) file, file_type,
 				abc_fn, 0);
-	free(file);
+#ifdef HAVE_MMAP
+	if (mapsz)
+		munmap(file, mapsz);
+	else
+#endif
+		free(file);
 
 	if (file_type == FE_PS)			/* PostScript file */
 		frontend((unsigned char *) "%%endps", FE_ABC,
@@ -402,6 +464,374 @@ static void read_def_format(void)
 	treat_file("default.fmt", "fmt");
 }
 
+/* -- display the arena statistics -- */
+static void arena_report(void)
+{
+	int level;
+	static char *level_txt[MAXAREAL] = {"global", "tune", "generation"};
+
+	fprintf(stderr, "Memory (KiB): level areas used big (allocations)\n");
+	for (level = 0; level < MAXAREAL; level++) {
+		if (str_st[level].used > str_st[level].max)
+			str_st[level].max = str_st[level].used;
+		if (str_st[level].big > str_st[level].bigmax)
+			str_st[level].bigmax = str_st[level].big;
+		fprintf(stderr, "    %-10s %6d %8lu %8lu (%d)\n",
+			level_txt[level],
+			str_st[level].nareas * (AREANASZ / 1024),
+			(unsigned long) (str_st[level].max + 1023) / 1024,
+			(unsigned long) (str_st[level].bigmax + 1023) / 1024,
+			str_st[level].nbig);
+	}
+}
+
+/* -- terminate the generation -- */
+static int end_output(void)
+{
+	if (memreport)
+		arena_report();
+	if (multicol_start != 0) {		/* lack of %%multicol end */
+		error(1, NULL, "Lack of %%%%multicol end");
+		multicol_start = 0;
+		buffer_eob(0);
+		if (!info['X' - 'A']
+		 && !epsf)
+			write_buffer();
+	}
+	if (!epsf && !fout) {
+		error(1, NULL, "Nothing to generate!");
+		return EXIT_FAILURE;
+	}
+	close_output_file();
+	return severity == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#ifdef HAVE_JOBS
+/* -- copy the output of a worker -- */
+static void job_copy(FILE *f, FILE *o)
+{
+	char buf[4096];
+	size_t l;
+
+	rewind(f);
+	while ((l = fread(buf, 1, sizeof buf, f)) > 0)
+		fwrite(buf, 1, l, o);
+	fclose(f);
+}
+
+/* -- rename the output files of a worker -- */
+/* the file contains the pairs of temporary and final names,
+ * each name ending with a null character */
+static void job_rename(FILE *f)
+{
+	char tmp[FILENAME_MAX], fn[FILENAME_MAX], *p;
+	int c;
+
+	rewind(f);
+	for (;;) {
+		p = tmp;
+		while ((c = getc(f)) > 0 && p < &tmp[sizeof tmp - 1])
+			*p++ = c;
+		*p = '\0';
+		p = fn;
+		while ((c = getc(f)) > 0 && p < &fn[sizeof fn - 1])
+			*p++ = c;
+		*p = '\0';
+		if (c < 0)
+			break;
+		if (rename(tmp, fn) != 0) {
+			error(1, NULL, "Cannot rename %s to %s", tmp, fn);
+			remove(tmp);
+		}
+	}
+	fclose(f);
+}
+
+/* -- wait for a worker and report the finished jobs in the file order -- */
+static void job_wait(void)
+{
+	struct job_s *job;
+	pid_t pid;
+	int i, status;
+
+	pid = wait(&status);
+	if (pid < 0) {
+		error(1, NULL, "Lost the worker processes - aborting");
+		exit(EXIT_FAILURE);
+	}
+	for (i = job_first; i < job_last; i++) {
+		job = &jobs[i];
+		if (job->pid != pid)
+			continue;
+		job->status = WIFEXITED(status) ?
+				WEXITSTATUS(status) : EXIT_FAILURE;
+		nrun--;
+		break;
+	}
+	while (job_first < job_last) {
+		job = &jobs[job_first];
+		if (job->status < 0)
+			break;
+		job_copy(job->out, stdout);
+		job_copy(job->err, stderr);
+		job_rename(job->ren);
+		if (job->status != EXIT_SUCCESS)
+			severity = 1;
+		job_first++;
+	}
+	fflush(stdout);
+	fflush(stderr);
+}
+
+/* -- treat a range of an ABC file in a worker process -- */
+/* the worker starts from the state defined by the command line,
+ * so, the file is treated as if it were alone */
+/* when the range does not start at the beginning of the file,
+ * the messages are not output until the start of the range */
+/* the output files are written under temporary names and renamed
+ * when the job is reported, so that, when many tunes have the same
+ * title, the last one wins as in a sequential run */
+static void job_run(char *fn, long start, long stop)
+{
+	struct job_s *job;
+	int fd;
+
+	while (nrun >= njobs)
+		job_wait();
+	if (job_last >= job_max) {
+		job_max = job_max ? job_max * 2 : 64;
+		jobs = realloc(jobs, sizeof *jobs * job_max);
+		if (!jobs) {
+			error(1, NULL, "Out of memory - aborting");
+			exit(EXIT_FAILURE);
+		}
+	}
+	job = &jobs[job_last];
+	job->out = tmpfile();
+	job->err = tmpfile();
+	job->ren = tmpfile();
+	if (!job->out || !job->err || !job->ren) {
+		error(1, NULL, "Cannot create temporary file - aborting");
+		exit(EXIT_FAILURE);
+	}
+	fflush(stdout);
+	fflush(stderr);
+	job->pid = fork();
+	if (job->pid < 0) {
+		error(1, NULL, "Cannot create worker process - aborting");
+		exit(EXIT_FAILURE);
+	}
+	if (job->pid == 0) {
+		job_fd[0] = fileno(job->out);
+		job_fd[1] = fileno(job->err);
+		out_ren = job->ren;
+		out_id = job_last + 1;
+		fd = start == 0 ? -1 : open("/dev/null", O_WRONLY);
+		dup2(fd >= 0 ? fd : job_fd[0], 1);
+		dup2(fd >= 0 ? fd : job_fd[1], 2);
+		if (start != 0 || stop != 0)
+			frontend_range(start, stop);
+		treat_abc_file(fn);
+		exit(end_output());
+	}
+	job->status = -1;
+	job_last++;
+	nrun++;
+}
+
+/* -- treat an ABC file in worker processes -- */
+/* the file is split before the global definitions of some tunes
+ * into at most 'njobs' parts of about the same number of tunes */
+static void treat_abc_job(char *fn)
+{
+	char *file, *p, *q;
+	long *cut, start;
+	size_t mapsz;
+	int ncut, maxcut, i, n, intune, inblock;
+
+	file = *fn == '\0' ? NULL : read_file(fn, "abc", &mapsz);
+	if (!file) {
+		job_run(fn, 0, 0);	/* (the worker reports the errors) */
+		return;
+	}
+
+	/* get the possible cuts: the starts of the global definitions
+	 * following the end of a tune, when a tune comes next */
+	cut = NULL;
+	ncut = maxcut = 0;
+	intune = inblock = 0;
+	start = 0;
+	for (p = file; *p != '\0'; p = q) {
+		for (q = p; *q != '\0' && *q != '\n' && *q != '\r'; q++)
+			;
+		n = q - p;
+		if (*q == '\r')
+			q++;
+		if (*q == '\n')
+			q++;
+		if (inblock) {				/* %%begin..%%end */
+			if (strncmp(p, "%%end", 5) == 0)
+				inblock = 0;
+			continue;
+		}
+		while (n > 0 && isspace((unsigned char) p[n - 1]))
+			n--;
+		if (n == 0) {				/* empty line */
+			if (intune) {
+				intune = 0;
+				start = q - file;
+			}
+			continue;
+		}
+		if (strncmp(p, "%%begin", 7) == 0) {
+			inblock = 1;
+			continue;
+		}
+		if (p[0] != 'X' || p[1] != ':' || intune)
+			continue;
+		intune = 1;
+		if (start == 0)				/* first tune */
+			continue;
+		if (ncut >= maxcut) {
+			maxcut = maxcut ? maxcut * 2 : 256;
+			cut = realloc(cut, sizeof *cut * maxcut);
+			if (!cut) {
+				error(1, NULL, "Out of memory - aborting");
+				exit(EXIT_FAILURE);
+			}
+		}
+		cut[ncut++] = start;
+	}
+#ifdef HAVE_MMAP
+	if (mapsz)
+		munmap(file, mapsz);
+	else
+#endif
+		free(file);
+
+	/* start a worker for each part */
+	n = ncut + 1 < njobs ? ncut + 1 : njobs;	/* number of parts */
+	start = 0;
+	for (i = 1; i <= n; i++) {
+		long stop;
+
+		stop = i == n ? 0 : cut[(long) ncut * i / n];
+		job_run(fn, start, stop);
+		start = stop;
+	}
+	free(cut);
+}
+
+/* -- treat a request in a worker process -- */
+static void serve_request(char *abc)
+{
+	FILE *out;
+	char buf[4096];
+	pid_t pid;
+	long len;
+	size_t l;
+	int status;
+
+	out = tmpfile();
+	if (!out) {
+		error(1, NULL, "Cannot create temporary file - aborting");
+		exit(EXIT_FAILURE);
+	}
+	fflush(stdout);
+	fflush(stderr);
+	pid = fork();
+	if (pid < 0) {
+		error(1, NULL, "Cannot create worker process - aborting");
+		exit(EXIT_FAILURE);
+	}
+	if (pid == 0) {
+		dup2(fileno(out), 1);
+		lvlarena(0);
+		parse.abc_state = ABC_S_GLOBAL;
+		frontend((unsigned char *) abc, FE_ABC, "stdin", 0);
+		status = end_output();
+		fflush(stdout);
+		_exit(status);		/* don't touch the shared stdin */
+	}
+	if (waitpid(pid, &status, 0) < 0
+	 || !WIFEXITED(status))
+		status = EXIT_FAILURE;
+	else
+		status = WEXITSTATUS(status);
+
+	/* send the reply: "<status> <length>\n" and the generated file */
+	fseek(out, 0, SEEK_END);
+	len = ftell(out);
+	rewind(out);
+	printf("%d %ld\n", status, len);
+	while ((l = fread(buf, 1, sizeof buf, out)) > 0)
+		fwrite(buf, 1, l, stdout);
+	fclose(out);
+	fflush(stdout);
+}
+
+/* -- server loop -- */
+/* each request is "<length>\n" followed by <length> bytes of ABC */
+static int serve(void)
+{
+	char line[64], *abc, *p;
+	long len;
+
+	read_def_format();		/* done once for all requests */
+	strcpy(outfn, "-");
+	in_fname = "stdin";		/* (as given to frontend()) */
+	while (fgets(line, sizeof line, stdin)) {
+		len = strtol(line, &p, 10);
+		if (p == line || len < 0
+		 || (*p != '\n' && *p != '\r')) {
+			error(1, NULL, "Bad request header - aborting");
+			return EXIT_FAILURE;
+		}
+		abc = malloc(len + 1);
+		if (!abc
+		 || fread(abc, 1, len, stdin) != (size_t) len) {
+			error(1, NULL, "Truncated request - aborting");
+			return EXIT_FAILURE;
+		}
+		abc[len] = '\0';
+		serve_request(abc);
+		free(abc);
+	}
+	return EXIT_SUCCESS;
+}
+#endif
+
+/* -- treat an ABC file, possibly in a worker process -- */
+static void treat_abc(char *fn)
+{
+#ifdef HAVE_JOBS
+	if (server)
+		return;			/* ignored */
+	if (njobs > 1) {
+		treat_abc_job(fn);
+		return;
+	}
+#endif
+	treat_abc_file(fn);
+}
+
+/* -- start of the range of the tunes to treat (-J) -- */
+/* the global definitions before the range have been parsed,
+ * but the output of the previous tunes is done by an other worker */
+void job_range_start(void)
+{
+	abc_eof();
+	clear_buffer();
+#ifdef HAVE_JOBS
+	if (job_fd[0] >= 0) {
+		fflush(stdout);
+		fflush(stderr);
+		dup2(job_fd[0], 1);
+		dup2(job_fd[1], 2);
+	}
+#endif
+}
+
 /* -- set extension on a file name -- */
 void strext(char *fn, char *ext)
 {
@@ -460,7 +890,10 @@ static void usage(void)
 		"     -O fff  set outfile name to fff\n"
 		"     -O =    make outfile name from infile/title\n"
 		"     -i      indicate where are the errors\n"
-		"     -k kk   size of the PS output buffer in Kibytes\n"
+		"     -k kk   initial size of the PS output buffer in Kibytes\n"
+		"     -C dir  keep the SVG images of the tunes in the cache dir (-g)\n"
+		"     -J n    treat the files in n parallel processes (-E/-g and -O =)\n"
+		"     -R      server mode: treat the ABC requests from stdin\n"
 		"  .output formatting:\n"
 		"     -s xx   set scale factor to xx\n"
 		"     -w xx   set staff width (cm/in/pt)\n"
@@ -490,12 +923,14 @@ static void usage(void)
 		"  .input file selection/options:\n"
 		"     -e pattern\n"
 		"             tune selection\n"
+		"     -Y      use an index of the tunes for the selection (file.idx)\n"
 		"  .help/configuration:\n"
 		"     -V      show program version\n"
 		"     -h      show this command summary\n"
 		"     -H      show the format parameters\n"
 		"     -S      secure mode\n"
-		"     -q      quiet mode\n");
+		"     -q      quiet mode\n"
+		"     -W      show the memory usage\n");
 	exit(EXIT_SUCCESS);
 }
 
@@ -574,6 +1009,156 @@ static void set_opt(char *w, char *v)
 			"cmd_line", 0);
 }
 
+/* -- initialize the generation -- */
+static void init_all(void)
+{
+	clrarena(0);				/* global */
+	clrarena(1);				/* tunes */
+	clrarena(2);				/* generation */
+//	memset(&info, 0, sizeof info);
+	info['T' - 'A'] = &notitle;
+	notitle.text = "T:";
+	set_format();
+	init_deco();
+
+#ifdef linux
+	/* if not set, try to find where is the default format directory */
+	if (styd[0] == '\0')
+		wherefmtdir();
+#endif
+#ifdef HAVE_PANGO
+	pg_init();
+#endif
+}
+
+#ifdef LIBABCM2PS
+/* -- library interface - see libabcm2ps.h -- */
+static struct abcm2ps_opts lib_opts;
+static jmp_buf lib_jmp;		/* return of the fatal errors */
+static int lib_state;		/* 1: in a library call, -1: unusable */
+
+#ifdef HAVE_FUNOPEN
+static int lib_write(void *cookie, const char *buf, int size)
+{
+	return lib_opts.write(cookie, buf, size);
+}
+#else
+static ssize_t lib_write(void *cookie, const char *buf, size_t size)
+{
+	int n;
+
+	n = lib_opts.write(cookie, buf, size);
+	return n < 0 ? 0 : n;		/* (0 is the error of fopencookie) */
+}
+#endif
+
+static void lib_flush(void)
+{
+	fflush(fout);
+	if (lib_opts.end)
+		lib_opts.end(lib_opts.ctx);
+}
+
+int abcm2ps_init(const struct abcm2ps_opts *opts)
+{
+#ifndef HAVE_FUNOPEN
+	static cookie_io_functions_t lib_io = {
+		.write = lib_write,
+	};
+#endif
+	const char **pp;
+
+	if (fstdout) {
+		error(1, NULL, "abcm2ps_init called twice");
+		return -1;
+	}
+	lib_opts = *opts;
+#ifdef HAVE_FUNOPEN
+	fstdout = funopen(lib_opts.ctx, NULL, lib_write, NULL, NULL);
+#else
+	fstdout = fopencookie(lib_opts.ctx, "w", lib_io);
+#endif
+	if (!fstdout)
+		return -1;
+	if (setjmp(lib_jmp)) {
+		lib_state = -1;
+		return -1;
+	}
+	lib_state = 1;
+	setvbuf(fstdout, NULL, _IOFBF, FOUTBUFSZ);
+	out_flush = lib_flush;
+
+	quiet = 1;
+	switch (opts->output) {
+	case ABCM2PS_SVG: svg = 1; break;
+	case ABCM2PS_SVG_TUNE: epsf = 2; break;
+	case ABCM2PS_XHTML: svg = 2; break;
+	}
+	strcpy(outfn, "-");
+	if (opts->fmtdir)
+		styd = (char *) opts->fmtdir;
+	init_outbuf(64);
+	init_all();
+
+	read_def_format();
+	for (pp = opts->fmt; pp && *pp; pp++)
+		treat_file((char *) *pp, "fmt");
+	for (pp = opts->param; pp && *pp; pp += 2)
+		set_opt((char *) pp[0], (char *) pp[1]);
+	lib_state = 0;
+	return severity == 0 ? 0 : -1;
+}
+
+/* the formats defined outside the tunes apply to the next calls,
+ * as with many ABC files in the command line */
+int abcm2ps_render(const char *abc, int len)
+{
+	char *file;
+	int ret;
+
+	if (lib_state != 0)
+		return -1;
+	severity = 0;
+	file = malloc(len + 1);
+	if (!file)
+		return -1;
+	memcpy(file, abc, len);
+	file[len] = '\0';
+	if (setjmp(lib_jmp)) {		/* fatal error */
+		lib_state = -1;
+		return -1;
+	}
+	lib_state = 1;
+	in_fname = "";
+	mtime = time(NULL);
+	lvlarena(0);
+	parse.abc_state = ABC_S_GLOBAL;
+	frontend((unsigned char *) file, FE_ABC, "abc", 0);
+	free(file);
+	clrarena(1);				/* clear the tunes */
+	frontend((unsigned char *) "select\n", FE_FMT,
+			"cmd_line", 0);
+	ret = end_output() == EXIT_SUCCESS ? 0 : -1;
+	if (ferror(fstdout)) {		/* write error */
+		clearerr(fstdout);
+		ret = -1;
+	}
+	lib_state = 0;
+	return ret;
+}
+#endif
+
+/* -- stop on a fatal error -- */
+/* in the library, return to the caller instead of exiting */
+void fatal_exit(void)
+{
+#ifdef LIBABCM2PS
+	if (lib_state > 0)
+		longjmp(lib_jmp, 1);
+#endif
+	exit(EXIT_FAILURE);
+}
+
 /* -- main program -- */
 int main(int argc, char **argv)
 {
@@ -584,6 +1169,7 @@ int main(int argc, char **argv)
 		usage();
 
 	outfn[0] = '\0';
+	fstdout = stdout;
 	init_outbuf(64);
 
 	/* set the global flags */
@@ -613,12 +1199,18 @@ int main(int argc, char **argv)
 				break;
 			case 'h':
 				usage();	/* no return */
+				/* fall thru */
 			case 'p':
 				pipeformat = 1;	/* format for bagpipe regardless of key */
 				break;
 			case 'q':
 				quiet = 1;
 				break;
+			case 'R':
+#ifdef HAVE_JOBS
+				server = 1;
+#endif
+				break;
 			case 'S':
 				secure = 1;
 				break;
@@ -633,6 +1225,12 @@ int main(int argc, char **argv)
 				svg = 2;	/* SVG/XHTML */
 				epsf = 0;
 				break;
+			case 'W':
+				memreport = 1;
+				break;
+			case 'Y':
+				tuneindex = 1;
+				break;
 			case 'k': {
 				int kbsz;
 
@@ -647,10 +1245,29 @@ int main(int argc, char **argv)
 					p += strlen(p) - 1;
 				}
 
-				sscanf(aaa, "%d", &kbsz);
+				if (sscanf(aaa, "%d", &kbsz) != 1 || kbsz <= 0) {
+					error(1, NULL, "Bad value for '-k' %s - aborting",
+						aaa);
+					return EXIT_FAILURE;
+				}
 				init_outbuf(kbsz);
 				break;
 			    }
+			case 'J':
+				if (p[1] == '\0') {
+					if (--argc <= 0) {
+						error(1, NULL, "No value for '-J' - aborting");
+						return EXIT_FAILURE;
+					}
+					aaa = *++argv;
+				} else {
+					aaa = p + 1;
+					p += strlen(p) - 1;
+				}
+#ifdef HAVE_JOBS
+				sscanf(aaa, "%d", &njobs);
+#endif
+				break;
 			case 'O':
 				if (p[1] == '\0') {
 					if (--argc <= 0) {
@@ -673,7 +1290,7 @@ int main(int argc, char **argv)
 				svg = 0;
 				break;
 			default:
-				if (strchr("aBbDdeFfIjmNOsTw", c)) /* if with arg */
+				if (strchr("aBbCDdeFfIjmNOsTw", c)) /* if with arg */
 					p += strlen(p) - 1;	/* skip */
 				break;
 			}
@@ -682,25 +1299,29 @@ int main(int argc, char **argv)
 	if (!quiet)
 		display_version(0);
 
-	/* initialize */
-	clrarena(0);				/* global */
-	clrarena(1);				/* tunes */
-	clrarena(2);				/* generation */
-//	memset(&info, 0, sizeof info);
-	info['T' - 'A'] = &notitle;
-	notitle.text = "T:";
-	set_format();
-	init_deco();
-
-#ifdef linux
-	/* if not set, try to find where is the default format directory */
-	if (styd[0] == '\0')
-		wherefmtdir();
+#ifdef HAVE_JOBS
+	/* the workers must generate their own files */
+	/* (one file per tune, named from the title) */
+	if (njobs > 1) {
+		j = strlen(outfn);
+		if ((epsf != 1 && epsf != 2)
+		 || j == 0 || outfn[j - 1] != '=') {
+			error(0, NULL,
+				"'-J' needs '-E' or '-g' with '-O =' - ignored");
+			njobs = 0;
+		}
+	}
 #endif
-#ifdef HAVE_PANGO
-	pg_init();
+
+#ifdef HAVE_JOBS
+	if (server && (epsf == 1 || epsf == 3)) {
+		error(1, NULL, "Cannot use '-R' with '-E' or '-z' - aborting");
+		return EXIT_FAILURE;
+	}
 #endif
 
+	init_all();
+
 	/* if ABC embedded in XML, open the output file */
 	if (epsf == 3) {
 		open_fout();
@@ -720,7 +1341,7 @@ int main(int argc, char **argv)
 
 			if (p[1] == '\0') {		/* '-' alone */
 				if (in_fname) {
-					treat_abc_file(in_fname);
+					treat_abc(in_fname);
 					frontend((unsigned char *) "select\n", FE_FMT,
 							"cmd_line", 0);
 				}
@@ -874,7 +1495,10 @@ int main(int argc, char **argv)
 					break;
 				case 'p':
 				case 'q':
+				case 'R':
 				case 'S':
+				case 'W':
+				case 'Y':
 					break;
 				case 'v':
 				case 'X':
@@ -906,11 +1530,13 @@ int main(int argc, char **argv)
 				case 'a':
 				case 'B':
 				case 'b':
+				case 'C':
 				case 'D':
 				case 'd':
 				case 'e':
 				case 'F':
 				case 'I':
+				case 'J':
 				case 'j':
 				case 'k':
 				case 'L':
@@ -933,7 +1559,7 @@ int main(int argc, char **argv)
 						p += strlen(p) - 1;	/* stop */
 					}
 
-					if (strchr("BbfjkNs", c)) {	/* check num args */
+					if (strchr("BbfJjkNs", c)) {	/* check num args */
 						for (j = 0; j < strlen(aaa); j++) {
 							if (!strchr("0123456789.",
 								    aaa[j])) {
@@ -959,6 +1585,9 @@ int main(int argc, char **argv)
 					case 'b':
 						set_opt("measurefirst", aaa);
 						break;
+					case 'C':
+						cachedir = aaa;
+						break;
 					case 'D':
 						styd = aaa;
 						break;
@@ -983,6 +1612,7 @@ int main(int argc, char **argv)
 							cfmt.measurebox = 0;
 						lock_fmt(&cfmt.measurebox);
 						break;
+					case 'J':
 					case 'k':
 						break;
 					case 'm':
@@ -1030,40 +1660,67 @@ int main(int argc, char **argv)
 		}
 
 		if (in_fname) {
-			treat_abc_file(in_fname);
+			treat_abc(in_fname);
 			frontend((unsigned char *) "select\n", FE_FMT,
 						"cmd_line", 0);
 		}
 		in_fname = p;
 	}
 
-	if (in_fname)
-		treat_abc_file(in_fname);
-	if (multicol_start != 0) {		/* lack of %%multicol end */
-		error(1, NULL, "Lack of %%%%multicol end");
-		multicol_start = 0;
-		buffer_eob(0);
-		if (!info['X' - 'A']
-		 && !epsf)
-			write_buffer();
+#ifdef HAVE_JOBS
+	if (server) {
+		if (in_fname)
+			error(0, NULL, "ABC files ignored with '-R'");
+		return serve();
 	}
-	if (!epsf && !fout) {
-		error(1, NULL, "Nothing to generate!");
-		return EXIT_FAILURE;
+#endif
+	if (in_fname)
+		treat_abc(in_fname);
+#ifdef HAVE_JOBS
+	if (njobs > 1) {
+		while (nrun > 0)
+			job_wait();
+		return severity == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 	}
-	close_output_file();
-	return severity == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+#endif
+	return end_output();
 }
 
 /* -- arena routines -- */
+static struct str_a *newarena(int sz)
+{
+	struct str_a *a_p;
+
+	a_p = malloc(sizeof *str_r[0] + sz - 2);
+	if (!a_p) {
+		error(1, NULL, "getarena - out of memory (%d) - aborting", sz);
+		fatal_exit();
+	}
+	a_p->n = NULL;
+	a_p->sz = sz;
+	a_p->p = a_p->str;
+	a_p->r = sz;
+	return a_p;
+}
+
 void clrarena(int level)
 {
 	struct str_a *a_p;
 
+	/* free the big areas */
+	while ((a_p = str_b[level]) != NULL) {
+		str_b[level] = a_p->n;
+		free(a_p);
+	}
+	if (str_st[level].used > str_st[level].max)
+		str_st[level].max = str_st[level].used;
+	if (str_st[level].big > str_st[level].bigmax)
+		str_st[level].bigmax = str_st[level].big;
+	str_st[level].used = str_st[level].big = 0;
+
 	if ((a_p = str_r[level]) == NULL) {
-		str_r[level] = a_p = malloc(sizeof *str_r[0] + AREANASZ - 2);
-		a_p->sz = AREANASZ;
-		a_p->n = NULL;
+		str_r[level] = a_p = newarena(AREANASZ);
+		str_st[level].nareas++;
 	}
 	str_c[level] = a_p;
 	a_p->p = a_p->str;
@@ -1088,24 +1745,21 @@ void *getarena(int len)
 
 	a_p = str_c[str_level];
 	len = (len + 7) & ~7;		/* align at 64 bits boundary */
+	str_st[str_level].used += len;
+
+	/* big allocation in its own area, freed by clrarena() */
+	if (len > BIGAREANASZ) {
+		a_p = newarena(len);
+		a_p->n = str_b[str_level];
+		str_b[str_level] = a_p;
+		str_st[str_level].big += len;
+		str_st[str_level].nbig++;
+		return a_p->str;
+	}
 	if (len > a_p->r) {
-		if (len > MAXAREANASZ) {
-			error(1, NULL,
-				"getarena - data too wide %d - aborting",
-				len);
-			exit(EXIT_FAILURE);
-		}
-		if (len > AREANASZ) {			/* big allocation */
-			struct str_a *a_n;
-
-			a_n = a_p->n;
-			a_p->n = malloc(sizeof *str_r[0] + len - 2);
-			a_p->n->n = a_n;
-			a_p->n->sz = len;
-		} else if (a_p->n == 0) {		/* standard allocation */
-			a_p->n = malloc(sizeof *str_r[0] + AREANASZ - 2);
-			a_p->n->n = NULL;
-			a_p->n->sz = AREANASZ;
+		if (!a_p->n) {				/* standard allocation */
+			a_p->n = newarena(AREANASZ);
+			str_st[str_level].nareas++;
 		}
 		str_c[str_level] = a_p = a_p->n;
 		a_p->p = a_p->str;
@@ -241,23 +241,9 @@ struct posit_s {
 
 /* music element */
 struct SYMBOL { 		/* struct for a drawable symbol */
-	struct SYMBOL *abc_next, *abc_prev; /* source linkage */
-	struct SYMBOL *next, *prev;	/* voice linkage */
+	/* layout data, first cache line */
 	struct SYMBOL *ts_next, *ts_prev; /* time linkage */
-	struct SYMBOL *extra;	/* extra symbols (grace notes, tempo... */
-	char abc_type;		/* ABC symbol type */
-#define ABC_T_NULL	0
-#define ABC_T_INFO 	1		/* (text[0] gives the info type) */
-#define ABC_T_PSCOM	2
-#define ABC_T_CLEF	3
-#define ABC_T_NOTE	4
-#define ABC_T_REST	5
-#define ABC_T_BAR	6
-#define ABC_T_EOLN	7
-#define ABC_T_MREST	8		/* multi-measure rest */
-#define ABC_T_MREP	9		/* measure repeat */
-#define ABC_T_V_OVER	10		/* voice overlay */
-#define ABC_T_TUPLET	11
+	struct SYMBOL *next, *prev;	/* voice linkage */
 	unsigned char type;	/* symbol type */
 #define NO_TYPE		0	/* invalid type */
 #define NOTEREST	1	/* valid symbol types */
@@ -278,9 +264,19 @@ struct SYMBOL { 		/* struct for a drawable symbol */
 #define NSYMTYPES	16
 	unsigned char voice;	/* voice (0..nvoice) */
 	unsigned char staff;	/* staff (0..nstaff) */
-	unsigned char nhd;	/* number of notes in chord - 1 */
-	signed char pits[MAXHD]; /* pitches / clef */
-	int dur;		/* main note duration */
+	char abc_type;		/* ABC symbol type */
+#define ABC_T_NULL	0
+#define ABC_T_INFO 	1		/* (text[0] gives the info type) */
+#define ABC_T_PSCOM	2
+#define ABC_T_CLEF	3
+#define ABC_T_NOTE	4
+#define ABC_T_REST	5
+#define ABC_T_BAR	6
+#define ABC_T_EOLN	7
+#define ABC_T_MREST	8		/* multi-measure rest */
+#define ABC_T_MREP	9		/* measure repeat */
+#define ABC_T_V_OVER	10		/* voice overlay */
+#define ABC_T_TUPLET	11
 	int time;		/* starting time */
 	unsigned int sflags;	/* symbol flags */
 #define S_EOLN		0x0001		/* end of line */
@@ -313,6 +309,15 @@ struct SYMBOL { 		/* struct for a drawable symbol */
 #define S_NEW_SY	0x08000000	/* staff system change (%%staves) */
 #define S_RBSTART	0x10000000	// start of repeat bracket
 #define S_OTTAVA	0x20000000	// ottava decoration (start or stop)
+	float x;		/* x offset */
+	float shrink;		/* minimum space before symbol */
+	float space;		/* natural space before symbol */
+	float wl, wr;		/* left, right min width */
+	/* other drawing data */
+	struct SYMBOL *extra;	/* extra symbols (grace notes, tempo... */
+	int dur;		/* main note duration */
+	unsigned char nhd;	/* number of notes in chord - 1 */
+	signed char pits[MAXHD]; /* pitches / clef */
 	struct posit_s posit;	/* positions / directions */
 	signed char stem;	/* 1 / -1 for stem up / down */
 	signed char combine;	/* voice combine */
@@ -343,20 +348,17 @@ struct SYMBOL { 		/* struct for a drawable symbol */
 					 *	      # notes/rests if < 0
 					 *	nohdi1: # repeat */
 	int color;
-	float x;		/* x offset */
 	signed char y;		/* y offset of note head */
 	signed char ymn, ymx;	/* min, max, note head y offset */
 	signed char mid;	// y offset of the staff middle line
 	float xmx;		/* max h-pos of a head rel to top
 				 * width when STBRK */
 	float xs, ys;		/* coord of stem end / bar height */
-	float wl, wr;		/* left, right min width */
-	float space;		/* natural space before symbol */
-	float shrink;		/* minimum space before symbol */
 	float xmax;		/* max x offset */
 	struct gch *gch;	/* guitar chords / annotations */
 	struct lyrics *ly;	/* lyrics */
-
+	/* source data */
+	struct SYMBOL *abc_next, *abc_prev; /* source linkage */
 	char state;		/* symbol state in file/tune */
 #define ABC_S_GLOBAL 0			/* global */
 #define ABC_S_HEAD 1			/* in header (after X:) */
@@ -586,6 +588,7 @@ extern int epsf;		/* 1: EPSF, 2: SVG, 3: embedded ABC */
 extern int svg;			/* 1: SVG, 2: XHTML */
 extern int showerror;		/* show the errors */
 extern int pipeformat;		/* format for bagpipes */
+extern char *cachedir;		/* tune cache directory */
 
 extern char outfn[FILENAME_MAX]; /* output file name */
 extern char *in_fname;		/* current input file name */
@@ -593,6 +596,11 @@ extern time_t mtime;		/* last modification time of the input file */
 
 extern int file_initialized;	/* for output file */
 extern FILE *fout;		/* output file */
+#define FOUTBUFSZ 65536		/* stdio buffer of the output file */
+extern FILE *fstdout;		/* stream of the output file '-' */
+extern void (*out_flush)(void);	/* end of page/tune on fstdout (may be NULL) */
+extern FILE *out_ren;		/* renames of the -E/-g files (-J, may be NULL) */
+extern int out_id;		/* worker number (-J) */
 
 #define MAXTBLT 8
 struct tblt_s {
@@ -734,9 +742,61 @@ struct SYSTEM {			/* staff system */
 };
 extern struct SYSTEM *cursys;		/* current staff system */
 
+/* drawing operations
+ * (PostScript functions in PS, native operations in SVG - see put_op())
+ * In SVG, the values and the operations are put in binary form
+ * in the output buffer:
+ *	SVG_VAL + 3 bytes: sign and 20 bits of (value * 10), 7 bits per byte
+ *	SVG_OP + 1 byte: operation
+ * (the bytes have the bit 7 set, so OP_NB must be lower than 128) */
+#define SVG_VAL '\002'
+#define SVG_OP '\003'
+enum drawop {
+	/* note heads, rests and glyphs */
+	OP_hd, OP_Hd, OP_HD, OP_HDD, OP_breve, OP_longa, OP_ghd,
+	OP_custos, OP_xydef, OP_pshhd, OP_pfthd,
+	OP_r00, OP_r0, OP_r1, OP_r2, OP_r4, OP_r8,
+	OP_r16, OP_r32, OP_r64, OP_r128,
+	OP_mrest, OP_mrep, OP_mrep2, OP_srep, OP_showerror,
+	/* ledger lines */
+	OP_hl, OP_hl1, OP_hl2, OP_ghl,
+	/* clefs, key and time signatures */
+	OP_tclef, OP_cclef, OP_bclef, OP_pclef,	/* (clef type order) */
+	OP_stclef, OP_scclef, OP_sbclef, OP_spclef, OP_oct,
+	OP_sh0, OP_ft0, OP_nt0,
+	OP_csig, OP_ctsig, OP_imsig, OP_iMsig, OP_pmsig, OP_pMsig,
+	OP_tsig, OP_stsig,
+	/* stems, flags, dots and beams */
+	OP_su, OP_sd, OP_gu, OP_gd,
+	OP_sfu, OP_sfd, OP_sfs, OP_sgu, OP_sgd, OP_sgs,
+	OP_gua, OP_gda,
+	OP_dt, OP_rdots, OP_bm, OP_trem,
+	/* bars and staves */
+	OP_bar, OP_thbar, OP_dotbar, OP_brace, OP_bracket,
+	/* paths and text */
+	OP_M, OP_RM, OP_RL, OP_stroke, OP_SLW,
+	OP_show, OP_showc, OP_showr,
+	OP_wln, OP_hyph,
+	/* decorations */
+	OP_accent, OP_arp, OP_brth, OP_coda, OP_cpu, OP_cresc, OP_dim,
+	OP_dnb, OP_dplus, OP_emb, OP_glisq, OP_gliss, OP_grm, OP_hld,
+	OP_lmrd, OP_lphr, OP_ltr, OP_marcato, OP_mphr, OP_o8va, OP_o8vb,
+	OP_opend, OP_ped, OP_pedoff, OP_sgno, OP_sld, OP_snap, OP_sphr,
+	OP_stc, OP_thumb, OP_trl, OP_turn, OP_turnx, OP_umrd, OP_upb,
+	OP_wedge,
+	OP_NB
+};
+extern char *drawop_nm[OP_NB];	/* names of the drawing operations */
+
 /* -- external routines -- */
 /* abcm2ps.c */
+void fatal_exit(void)
+#ifdef __GNUC__
+	__attribute__ ((noreturn))
+#endif
+	;
 void include_file(unsigned char *fn);
+void job_range_start(void);
 void clrarena(int level);
 int lvlarena(int level);
 void *getarena(int len);
@@ -744,6 +804,7 @@ void strext(char *fid, char *ext);
 /* abcparse.c */
 void abc_parse(char *p, char *fname, int linenum);
 void abc_eof(void);
+int sym_size(struct SYMBOL *s);
 char *get_str(char *d,
 	      char *s,
 	      int maxlen);
@@ -756,12 +817,13 @@ void a2b(char *fmt, ...)
 	__attribute__ ((format (printf, 1, 2)))
 #endif
 	;
+void a2b_raw(char *p, int len);
 void block_put(void);
 void buffer_eob(int eot);
 void marg_init(void);
 void bskip(float h);
-void check_buffer(void);
 void init_outbuf(int kbsz);
+void clear_buffer(void);
 void close_output_file(void);
 void close_page(void);
 float get_bposy(void);
@@ -773,6 +835,8 @@ extern int (*output)(FILE *out, const char *fmt, ...)
 #endif
 	;
 void write_eps(void);
+unsigned long long cache_hash(unsigned long long h, const void *p, int len);
+int cache_get(unsigned long long key);
 /* deco.c */
 void deco_add(char *text);
 void deco_cnv(struct decos *dc, struct SYMBOL *s, struct SYMBOL *prev);
@@ -808,9 +872,12 @@ float draw_systems(float indent);
 void output_ps(struct SYMBOL *s, int color);
 struct SYMBOL *prev_scut(struct SYMBOL *s);
 void putf(float f);
+void puti(int v);
 void putx(float x);
 void puty(float y);
 void putxy(float x, float y);
+void put_op(int op, char sep);
+int op_find(char *name, int len);
 void set_scale(struct SYMBOL *s);
 void set_sscale(int staff);
 void set_color(int color);
@@ -838,6 +905,9 @@ void frontend(unsigned char *s,
 		int ftype,
 		char *fname,
 		int linenum);
+void frontend_stream(FILE *fin, char *fname);
+void frontend_range(long start, long stop);
+void tune_index(unsigned char *file, char *fn);
 /* glyph.c */
 char *glyph_out(char *p);
 void glyph_add(char *p);
@@ -847,6 +917,7 @@ void reset_gen(void);
 void unlksym(struct SYMBOL *s);
 /* parse.c */
 extern float multicol_start;
+void deco_set(int c, char *name);
 void do_tune(void);
 void identify_note(struct SYMBOL *s,
 		int len,
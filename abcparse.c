@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <ctype.h>
 
 #include "abcm2ps.h"
@@ -37,6 +38,10 @@ static int g_abc_vers, g_ulen, g_microscale;
 static char g_char_tb[128];
 static char *g_deco_tb[128];		/* global decoration names */
 static unsigned short g_micro_tb[MAXMICRO]; /* global microtone values */
+static char tune_saved;		/* global tables saved in the current tune */
+#define TS_CHAR 0x01			/* char_tb */
+#define TS_DECO 0x02			/* parse.deco_tb */
+#define TS_MICRO 0x04			/* parse.micro_tb */
 
 static char *abc_fn;		/* current source file name */
 static int linenum;		/* current source line number */
@@ -127,13 +132,62 @@ static void print_error(char *s, int col)
 		fprintf(stderr, "%s:%d: error: %s\n", abc_fn, linenum, s);
 }
 
+/* size of a symbol when its type dependent part is 'm' */
+#define SYM_SZ(m) (offsetof(struct SYMBOL, u) + sizeof ((struct SYMBOL *) 0)->u.m)
+
+/* -- size of a symbol from its ABC type -- */
+/* only the part of the union used by the type is allocated,
+ * the notes, rests and pseudo-comments may change of type
+ * and keep the full size */
+static int abc_size(int type, char *text)
+{
+	switch (type) {
+	case ABC_T_INFO:
+		switch (*text) {
+		case 'K':
+			return SYM_SZ(key);
+		case 'L':
+			return SYM_SZ(length);
+		case 'M':
+			return SYM_SZ(meter);
+		case 'Q':
+			return SYM_SZ(tempo);
+		case 'U':
+			return SYM_SZ(user);
+		case 'V':
+			return SYM_SZ(voice);
+		}
+		return offsetof(struct SYMBOL, u);
+	case ABC_T_CLEF:
+		return SYM_SZ(clef);
+	case ABC_T_BAR:
+	case ABC_T_MREP:
+		return SYM_SZ(bar);
+	case ABC_T_EOLN:
+		return SYM_SZ(eoln);
+	case ABC_T_V_OVER:
+		return SYM_SZ(v_over);
+	case ABC_T_TUPLET:
+		return SYM_SZ(tuplet);
+	}
+	return sizeof(struct SYMBOL);
+}
+
+/* -- allocated size of a symbol -- */
+int sym_size(struct SYMBOL *s)
+{
+	return abc_size(s->abc_type, s->text);
+}
+
 /* -- new symbol -- */
 static struct SYMBOL *abc_new(int type, char *text)
 {
 	struct SYMBOL *s;
+	int size;
 
-	s = getarena(sizeof(struct SYMBOL));
-	memset(s, 0, sizeof(struct SYMBOL));
+	size = abc_size(type, text);
+	s = getarena(size);
+	memset(s, 0, size);
 	if (text) {
 		s->text = getarena(strlen(text) + 1);
 		strcpy(s->text, text);
@@ -155,6 +209,41 @@ static struct SYMBOL *abc_new(int type, char *text)
 	return s;
 }
 
+/* -- save a global table before its first change in a tune -- */
+static void tune_save(int tb)
+{
+	if (parse.abc_state == ABC_S_GLOBAL
+	 || (tune_saved & tb))
+		return;
+	tune_saved |= tb;
+	switch (tb) {
+	case TS_CHAR:
+		memcpy(g_char_tb, char_tb, sizeof g_char_tb);
+		break;
+	case TS_DECO:
+		memcpy(g_deco_tb, parse.deco_tb, sizeof g_deco_tb);
+		break;
+	case TS_MICRO:
+		memcpy(g_micro_tb, parse.micro_tb, sizeof g_micro_tb);
+		break;
+	}
+}
+
+/* -- restore the global values at end of tune -- */
+static void tune_restore(void)
+{
+	parse.abc_vers = g_abc_vers;
+	ulen = g_ulen;
+	microscale = g_microscale;
+	if (tune_saved & TS_CHAR)
+		memcpy(char_tb, g_char_tb, sizeof g_char_tb);
+	if (tune_saved & TS_DECO)
+		memcpy(parse.deco_tb, g_deco_tb, sizeof parse.deco_tb);
+	if (tune_saved & TS_MICRO)
+		memcpy(parse.micro_tb, g_micro_tb, sizeof parse.micro_tb);
+	tune_saved = 0;
+}
+
 /* -- parse an ABC line -- */
 void abc_parse(char *p, char *fname, int ln)
 {
@@ -170,9 +259,6 @@ void abc_parse(char *p, char *fname, int ln)
 		g_microscale = microscale;
 
 		meter = 2;
-		memcpy(g_char_tb, char_tb, sizeof g_char_tb);
-		memcpy(g_deco_tb, parse.deco_tb, sizeof g_deco_tb);
-		memcpy(g_micro_tb, parse.micro_tb, sizeof g_micro_tb);
 		break;
 	case 1:				/* end of tune */
 		if (parse.first_sym) {
@@ -180,13 +266,9 @@ void abc_parse(char *p, char *fname, int ln)
 			parse.first_sym = parse.last_sym = NULL;
 		}
 		parse.abc_state = ABC_S_GLOBAL;
-		parse.abc_vers = g_abc_vers;
-		ulen = g_ulen;
-		microscale = g_microscale;
-		memcpy(char_tb, g_char_tb, sizeof g_char_tb);
-		memcpy(parse.deco_tb, g_deco_tb, sizeof parse.deco_tb);
-		memcpy(parse.micro_tb, g_micro_tb, sizeof parse.micro_tb);
+		tune_restore();
 		lvlarena(0);
+		clrarena(1);		/* free the tune */
 		if (dc.n > 0)
 			syntax("Decoration without symbol", 0);
 		dc.n = 0;
@@ -201,12 +283,8 @@ void abc_eof(void)
 //		severity = 1;
 	do_tune();
 	parse.first_sym = parse.last_sym = NULL;
-	if (parse.abc_state != ABC_S_GLOBAL) {
-		parse.abc_vers = g_abc_vers;
-		ulen = g_ulen;
-		microscale = g_microscale;
-		memcpy(char_tb, g_char_tb, sizeof g_char_tb);
-	}
+	if (parse.abc_state != ABC_S_GLOBAL)
+		tune_restore();
 }
 
 /* -- treat the broken rhythm '>' and '<' -- */
@@ -393,6 +471,7 @@ static char *get_deco(char *p,
 
 	/* new decoration */
 	if (i < DC_NAME_SZ) {
+		tune_save(TS_DECO);
 //		if (parse.abc_state != ABC_S_GLOBAL)
 //			lvlarena(0);
 		*t = getarena(l + 1);
@@ -1176,6 +1255,7 @@ static char *get_user(char *p,
 			break;
 		}
 	}
+	tune_save(TS_CHAR);
 	switch (char_tb[c]) {
 	default:
 		return "Bad decoration character";
@@ -1594,6 +1674,7 @@ char *parse_acc_pit(char *p,
 				if (parse.micro_tb[n] == d)
 					break;
 				if (parse.micro_tb[n] == 0) {
+					tune_save(TS_MICRO);
 					parse.micro_tb[n] = d;
 					break;
 				}
@@ -1866,6 +1947,7 @@ static int parse_line(char *p)
 			s = abc_new(ABC_T_PSCOM, p);
 			p += 2;				/* skip '%%' */
 			if (strncasecmp(p, "decoration ", 11) == 0) {
+				tune_save(TS_CHAR);
 				p += 11;
 				while (isspace((unsigned char) *p))
 					p++;
@@ -1882,6 +1964,7 @@ static int parse_line(char *p)
 				return 0;
 			}
 			if (strncasecmp(p, "linebreak ", 10) == 0) {
+				tune_save(TS_CHAR);
 				for (i = 0; i < sizeof char_tb; i++) {
 					if (char_tb[i] == CHAR_LINEBREAK)
 						char_tb[i] = i != '!' ?
@@ -2541,6 +2624,8 @@ static int parse_info(char *p)
 	char info_type = *p;
 	char *error_txt = NULL;
 
+	if (info_type == 'X')
+		lvlarena(1);		/* the tune starts here */
 	s = abc_new(ABC_T_INFO, p);
 
 	p += 2;
@@ -2595,7 +2680,6 @@ static int parse_info(char *p)
 		nvoice = 0;
 		curvoice = voice_tb;
 		parse.abc_state = ABC_S_HEAD;
-		lvlarena(1);
 		return 2;
 	}
 	if (error_txt)
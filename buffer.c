@@ -20,14 +20,15 @@
 #include "abcm2ps.h" 
 
 #define PPI_96_72 0.75		// convert page format to 72 PPI
-#define BUFFLN	80		/* max number of lines in output buffer */
+#define BUFFLN	80		/* initial number of lines in output buffer */
 
 static int ln_num;		/* number of lines in buffer */
-static float ln_pos[BUFFLN];	/* vertical positions of buffered lines */
-static char *ln_buf[BUFFLN];	/* buffer location of buffered lines */
-static float ln_lmarg[BUFFLN];	/* left margin of buffered lines */
-static float ln_scale[BUFFLN];	/* scale of buffered lines */
-static signed char ln_font[BUFFLN];	/* font of buffered lines */
+static int ln_max;		/* size of the line tables */
+static float *ln_pos;		/* vertical positions of buffered lines */
+static int *ln_buf;		/* end offset in outbuf of buffered lines */
+static float *ln_lmarg;		/* left margin of buffered lines */
+static float *ln_scale;		/* scale of buffered lines */
+static signed char *ln_font;	/* font of buffered lines */
 static float cur_lmarg = 0;	/* current left margin */
 static float max_rmarg;		/* margins for -E/-g */
 static float cur_scale = 1.0;	/* current scale */
@@ -38,7 +39,11 @@ static int nepsf;		/* counter for -E/-g output files */
 static int nbpages;		/* number of pages in the output file */
 	int outbufsz;		/* size of outbuf */
 static char outfnam[FILENAME_MAX]; /* internal file name for open/close */
+static char outtmp[FILENAME_MAX + 32]; /* temporary name of outfnam (-J) */
+static int nouttmp;		/* number of temporary output files (-J) */
 static struct FORMAT *p_fmt;	/* current format while treating a new page */
+static char cache_fn[FILENAME_MAX]; /* cache entry of the current tune */
+static int cache_nout;		/* number of images of the current tune */
 
 int (*output)(FILE *out, const char *fmt, ...);
 
@@ -99,7 +104,7 @@ void open_fout(void)
 		if (strncmp(fnm, outfnam, i) != 0)
 			nepsf = 0;
 		sprintf(&fnm[i + 1], "%03d.svg", ++nepsf);
-	} else if (strcmp(fnm, outfnam) == 0) {
+	} else if (fout && strcmp(fnm, outfnam) == 0) {
 		return;				/* same output file */
 	}
 
@@ -108,10 +113,11 @@ void open_fout(void)
 	if (i != 0 || fnm[0] != '-') {
 		if ((fout = fopen(fnm, "w")) == NULL) {
 			error(1, NULL, "Cannot create output file %s - abort", fnm);
-			exit(EXIT_FAILURE);
+			fatal_exit();
 		}
+		setvbuf(fout, NULL, _IOFBF, FOUTBUFSZ);	/* ~ one write per page */
 	} else {
-		fout = stdout;
+		fout = fstdout;
 	}
 }
 
@@ -248,8 +254,11 @@ static void close_fout(void)
 {
 	long m;
 
-	if (fout == stdout)
+	if (fout == fstdout) {
+		if (out_flush)
+			out_flush();
 		goto out2;
+	}
 	if (quiet)
 		goto out1;
 	m = ftell(fout);
@@ -314,8 +323,12 @@ void close_page(void)
 	in_page = 0;
 	if (svg) {
 		svg_close();
-		if (svg == 1 && fout != stdout)
-			close_fout();
+		if (svg == 1) {
+			if (fout != fstdout)
+				close_fout();
+			else if (out_flush)
+				out_flush();
+		}
 //		else
 //			fputs("</p>\n", fout);
 	} else {
@@ -473,8 +486,12 @@ static float headfooter(int header,
 	mbf_sav = mbf;
 	outbuf_sav = outbuf;
 	outbufsz_sav = outbufsz;
-	outbuf = tmp;
-	outbufsz = sizeof tmp;
+	outbufsz = 2048;
+	outbuf = malloc(outbufsz);		/* (may grow in a2b()) */
+	if (!outbuf) {
+		error(1, NULL, "Out of memory for outbuf - abort");
+		fatal_exit();
+	}
 	for (;;) {
 		tex_str(p);
 		strcpy(tmp, tex_buf);
@@ -487,13 +504,13 @@ static float headfooter(int header,
 				*q = '\0';
 				output(fout, "%.1f %.1f M ",
 					p_fmt->leftmargin, y);
-				mbf = tmp;
+				mbf = outbuf;
 				str_out(p, A_LEFT);
 				a2b("\n");
 				if (svg)
-					svg_write(tmp, strlen(tmp));
+					svg_write(outbuf, mbf - outbuf);
 				else
-					fputs(tmp, fout);
+					fputs(outbuf, fout);
 			}
 			p = q + 1;
 		}
@@ -504,13 +521,13 @@ static float headfooter(int header,
 		if (q != p) {
 			output(fout, "%.1f %.1f M ",
 				pwidth * 0.5, y);
-			mbf = tmp;
+			mbf = outbuf;
 			str_out(p, A_CENTER);
 			a2b("\n");
 			if (svg)
-				svg_write(tmp, strlen(tmp));
+				svg_write(outbuf, mbf - outbuf);
 			else
-				fputs(tmp, fout);
+				fputs(outbuf, fout);
 		}
 
 		/* right side */
@@ -519,13 +536,13 @@ static float headfooter(int header,
 			if (*p != '\0') {
 				output(fout, "%.1f %.1f M ",
 					pwidth - p_fmt->rightmargin, y);
-				mbf = tmp;
+				mbf = outbuf;
 				str_out(p, A_RIGHT);
 				a2b("\n");
 				if (svg)
-					svg_write(tmp, strlen(tmp));
+					svg_write(outbuf, mbf - outbuf);
 				else
-					fputs(tmp, fout);
+					fputs(outbuf, fout);
 			}
 		}
 		if (!r)
@@ -537,6 +554,7 @@ static float headfooter(int header,
 	}
 
 	/* restore the buffer and fonts */
+	free(outbuf);
 	outbuf = outbuf_sav;
 	outbufsz = outbufsz_sav;
 	mbf = mbf_sav;
@@ -673,6 +691,127 @@ static void epsf_title(char *p, int sz)
 	}
 }
 
+/* -- tune cache (-C) -- */
+/* A cache entry is the SVG image of a tune (-g).
+ * The key is a hash of the tune source, of all the definitions
+ * which were found before the tune, of the command line,
+ * of the program version and of the file counter. */
+
+/* -- add some data to a hash value (FNV-1a) -- */
+unsigned long long cache_hash(unsigned long long h, const void *p, int len)
+{
+	const unsigned char *q = p;
+
+	while (--len >= 0) {
+		h ^= *q++;
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+/* -- open the EPS or SVG file of a tune -- */
+/* with -J, the file is written under a temporary name, and the main
+ * process renames it when the messages of the worker are output */
+static FILE *open_eps(void)
+{
+	FILE *f;
+	char *fn;
+
+	fn = outfnam;
+	if (out_ren) {
+		snprintf(outtmp, sizeof outtmp, "%s.%d-%d.tmp",
+				outfnam, out_id, ++nouttmp);
+		fn = outtmp;
+	}
+	if ((f = fopen(fn, "w")) == NULL) {
+		error(1, NULL, "Cannot open output file %s - abort", outfnam);
+		fatal_exit();
+	}
+	if (out_ren) {
+		fwrite(outtmp, 1, strlen(outtmp) + 1, out_ren);
+		fwrite(outfnam, 1, strlen(outfnam) + 1, out_ren);
+		fflush(out_ren);
+	}
+	return f;
+}
+
+/* -- check if a tune is in the cache -- */
+/* if so, copy its image to the output file and return 1 */
+/* (the key 0 is used for the tunes which cannot be cached) */
+int cache_get(unsigned long long key)
+{
+	FILE *f, *o;
+	char buf[4096], *p;
+	size_t l;
+	long m;
+	int i;
+
+	cache_fn[0] = '\0';
+	if (key == 0
+	 || strcmp(outfn, "-") == 0)
+		return 0;
+	key = cache_hash(key, VERSION, sizeof VERSION);
+	for (i = 1; i < s_argc; i++)
+		key = cache_hash(key, s_argv[i], strlen(s_argv[i]) + 1);
+	key = cache_hash(key, &nepsf, sizeof nepsf);
+	snprintf(cache_fn, sizeof cache_fn, "%s%c%016llx",
+			cachedir, DIRSEP, key);
+	cache_nout = 0;
+
+	/* the entry starts with the file counter and the output file name */
+	f = fopen(cache_fn, "rb");
+	if (!f)
+		return 0;
+	if (!fgets(buf, sizeof buf, f)
+	 || sscanf(buf, "%d", &i) != 1
+	 || (p = strchr(buf, ' ')) == NULL) {
+		fclose(f);
+		return 0;
+	}
+	p[strcspn(p, "\n")] = '\0';
+	strcpy(outfnam, p + 1);
+	o = open_eps();
+	while ((l = fread(buf, 1, sizeof buf, f)) > 0)
+		fwrite(buf, 1, l, o);
+	m = ftell(o);
+	fclose(o);
+	fclose(f);
+
+	nepsf = i;
+	tunenum++;
+	if (!quiet)
+		printf("Output written on %s (%ld bytes)\n", outfnam, m);
+	cache_fn[0] = '\0';
+	return 1;
+}
+
+/* -- put the image of the current tune into the cache -- */
+static void cache_put(void)
+{
+	FILE *f, *o;
+	char buf[4096], tmp[FILENAME_MAX + 16];
+	size_t l;
+
+	if (++cache_nout != 1) {	/* many images: don't cache */
+		remove(cache_fn);
+		cache_fn[0] = '\0';
+		return;
+	}
+	if ((f = fopen(out_ren ? outtmp : outfnam, "rb")) == NULL)
+		return;
+	snprintf(tmp, sizeof tmp, "%s.%d.tmp", cache_fn, out_id);
+	if ((o = fopen(tmp, "wb")) == NULL) {
+		fclose(f);
+		return;
+	}
+	fprintf(o, "%d %s\n", nepsf, outfnam);
+	while ((l = fread(buf, 1, sizeof buf, f)) > 0)
+		fwrite(buf, 1, l, o);
+	fclose(f);
+	if (fclose(o) != 0 || rename(tmp, cache_fn) != 0)
+		remove(tmp);
+}
+
 /* -- output a EPS (-E) or SVG (-g) file -- */
 void write_eps(void)
 {
@@ -694,9 +833,9 @@ void write_eps(void)
 		if (i == 0 && outfnam[0] == '-') {
 			if (epsf == 1) {
 				error(1, NULL, "Cannot use stdout with '-E' - abort");
-				exit(EXIT_FAILURE);
+				fatal_exit();
 			}
-			fout = stdout;
+			fout = fstdout;
 		} else {
 			if (outfnam[i] == '=') {
 				p = &info['T' - 'A']->text[2];
@@ -711,11 +850,7 @@ void write_eps(void)
 				sprintf(&outfnam[i + 1], "%03d", ++nepsf);
 			}
 			strcat(outfnam, epsf == 1 ? ".eps" : ".svg");
-			if ((fout = fopen(outfnam, "w")) == NULL) {
-				error(1, NULL, "Cannot open output file %s - abort",
-						outfnam);
-				exit(EXIT_FAILURE);
-			}
+			fout = open_eps();
 		}
 	}
 	epsf_title(title, sizeof title);
@@ -731,33 +866,73 @@ void write_eps(void)
 		write_buffer();
 		svg_close();
 	}
-	if (epsf != 3)
+	if (epsf != 3) {
 		close_fout();
-	else
+		if (cache_fn[0] != '\0')
+			cache_put();
+	} else {
 		file_initialized = 0;
+	}
 	cur_scale = 1.0;
+	remy = 0;		/* there is no page: the next image starts as
+				 * the first one */
 }
 
 /*  subroutines to handle output buffer  */
 
+/* -- make room for 'len' more bytes in the output buffer -- */
+static void a2b_grow(int len)
+{
+	char *p;
+
+	if (outbufsz < BSIZE)
+		outbufsz = BSIZE;
+	do {
+		outbufsz *= 2;
+	} while (mbf + len >= outbuf + outbufsz);
+	p = realloc(outbuf, outbufsz);
+	if (!p) {
+		error(1, NULL, "Out of memory for outbuf - abort");
+		fatal_exit();
+	}
+	mbf = p + (mbf - outbuf);
+	outbuf = p;
+}
+
+/* -- check if there is room for a new element in the output buffer -- */
+static void a2b_check(void)
+{
+	if (mbf + BSIZE > outbuf + outbufsz)
+		a2b_grow(BSIZE);
+}
+
 /* -- update the output buffer pointer -- */
 void a2b(char *fmt, ...)
 {
 	va_list args;
+	int l;
 
-	if (mbf + BSIZE > outbuf + outbufsz) {
-		if (epsf) {
-			error(1, NULL, "Output buffer overflow - increase outbufsz");
-			fprintf(stderr, "*** abort\n");
-			exit(EXIT_FAILURE);
-		}
-		error(0, NULL, "Possible buffer overflow");
-		write_buffer();
-//		use_buffer = 0;
-	}
+	a2b_check();
 	va_start(args, fmt);
-	mbf += vsnprintf(mbf, outbuf + outbufsz - mbf, fmt, args);
+	l = vsnprintf(mbf, outbuf + outbufsz - mbf, fmt, args);
 	va_end(args);
+	if (mbf + l >= outbuf + outbufsz) {	/* truncated */
+		a2b_grow(l + 1);
+		va_start(args, fmt);
+		vsnprintf(mbf, outbuf + outbufsz - mbf, fmt, args);
+		va_end(args);
+	}
+	mbf += l;
+}
+
+/* -- put raw bytes in the output buffer -- */
+void a2b_raw(char *p, int len)
+{
+	if (mbf + len + BSIZE > outbuf + outbufsz)
+		a2b_grow(len + BSIZE);
+	memcpy(mbf, p, len);
+	mbf += len;
+	*mbf = '\0';
 }
 
 /* -- translate down by 'h' scaled points in output buffer -- */
@@ -769,7 +944,23 @@ void bskip(float h)
 	a2b("0 %.2f T\n", -h);
 }
 
+/* -- (re)allocate the tables of the buffered lines -- */
+static void ln_grow(void)
+{
+	ln_max = ln_max ? ln_max * 2 : BUFFLN;
+	ln_pos = realloc(ln_pos, ln_max * sizeof *ln_pos);
+	ln_buf = realloc(ln_buf, ln_max * sizeof *ln_buf);
+	ln_lmarg = realloc(ln_lmarg, ln_max * sizeof *ln_lmarg);
+	ln_scale = realloc(ln_scale, ln_max * sizeof *ln_scale);
+	ln_font = realloc(ln_font, ln_max * sizeof *ln_font);
+	if (!ln_pos || !ln_buf || !ln_lmarg || !ln_scale || !ln_font) {
+		error(1, NULL, "Out of memory for the buffer lines - abort");
+		fatal_exit();
+	}
+}
+
 /* -- initialize the output buffer -- */
+/* (kbsz is the initial size - the buffer grows when needed) */
 void init_outbuf(int kbsz)
 {
 	if (outbuf)
@@ -780,13 +971,23 @@ void init_outbuf(int kbsz)
 	outbuf = malloc(outbufsz);
 	if (!outbuf) {
 		error(1, NULL, "Out of memory for outbuf - abort");
-		exit(EXIT_FAILURE);
+		fatal_exit();
 	}
+	if (!ln_max)
+		ln_grow();
 	bposy = 0;
 	ln_num = 0;
 	mbf = outbuf;
 }
 
+/* -- discard the buffer contents -- */
+void clear_buffer(void)
+{
+	mbf = outbuf;
+	ln_num = 0;
+	bposy = 0;
+}
+
 /* -- write buffer contents, break at full pages -- */
 void write_buffer(void)
 {
@@ -845,9 +1046,9 @@ void write_buffer(void)
 		}
 		if (*p_buf != '\001') {
 			if (epsf > 1 || svg)
-				svg_write(p_buf, ln_buf[l] - p_buf);
+				svg_write(p_buf, outbuf + ln_buf[l] - p_buf);
 			else
-				fwrite(p_buf, 1, ln_buf[l] - p_buf, fout);
+				fwrite(p_buf, 1, outbuf + ln_buf[l] - p_buf, fout);
 		} else {			/* %%EPS - see parse.c */
 			FILE *f;
 			char line[BSIZE], *p, *q;
@@ -890,7 +1091,7 @@ void write_buffer(void)
 				fclose(f);
 			}
 		}
-		p_buf = ln_buf[l];
+		p_buf = outbuf + ln_buf[l];
 		remy += dp;
 		p1 = ln_pos[l];
 	}
@@ -919,24 +1120,11 @@ void block_put(void)
 	if (remy == 0)
 		remy = maxy = (cfmt.landscape ? cfmt.pagewidth : cfmt.pageheight)
 			- cfmt.topmargin - cfmt.botmargin;
-	if (ln_num > 0 && mbf == ln_buf[ln_num - 1])
+	if (ln_num > 0 && mbf == outbuf + ln_buf[ln_num - 1])
 		return;				/* no data */
-	if (ln_num >= BUFFLN) {
-		char c, *p;
-
-		error(1, NULL, "max number of buffer lines exceeded"
-				" -- check BUFFLN");
-		multicol_start = 0;
-		p = ln_buf[ln_num - 1];
-		c = *p;				/* (avoid "buffer not empty") */
-		*p = '\0';
-		write_buffer();
-		multicol_start = remy + bposy;
-		*p = c;
-		strcpy(outbuf, p);
-//		use_buffer = 0;
-	}
-	ln_buf[ln_num] = mbf;
+	if (ln_num >= ln_max)
+		ln_grow();
+	ln_buf[ln_num] = mbf - outbuf;
 	ln_pos[ln_num] = multicol_start == 0 ? bposy : 1;
 	ln_lmarg[ln_num] = cfmt.leftmargin;
 	ln_scale[ln_num] = cfmt.scale;
@@ -1004,17 +1192,6 @@ void buffer_eob(int eot)
 #endif
 }
 
-/* -- dump buffer if not enough place for a music line -- */
-void check_buffer(void)
-{
-	if (mbf + 5000 > outbuf + outbufsz) { /* assume music line < 5000 bytes */
-		error(0, NULL,
-		      "Possibly bad page breaks, outbufsz exceeded");
-		write_buffer();
-//		use_buffer = 0;
-	}
-}
-
 /* -- return the current vertical offset in the page -- */
 float get_bposy(void)
 {
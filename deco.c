@@ -82,6 +82,8 @@ static const short f_staff = (1 << 6) | (1 << 7);
 
 /* postscript function table */
 static char *ps_func_tb[128];
+static signed char ps_op_tb[128][2];	/* drawing operations (up, down)
+					 * op + 1, -1 if none, 0 if unknown */
 
 static char *str_tb[32];
 
@@ -917,7 +919,8 @@ static unsigned char deco_build(char *name, char *text)
 
 	/* set the values */
 	if (!dd->name)
-		dd->name = name;	/* new decoration */
+		dd->name = strdup(name); /* new decoration
+					  * (the name may be in the tune arena) */
 	dd->func = strncmp(dd->name, "head-", 5) == 0 ? 9 : c_func;
 	if (!ps_func_tb[ps_x]) {
 		if (ps_func[0] == '-' && ps_func[1] == '\0')
@@ -963,8 +966,7 @@ static unsigned char deco_build(char *name, char *text)
 			}
 		}
 		if (o >= 128 || !ddo->name)
-//fixme: memory leak...
-			deco_define(strdup(name2));
+			deco_define(name2);
 	}
  	dd->strx = strx;
 	return ideco;
@@ -1330,7 +1332,7 @@ void draw_all_deco(void)
 	struct deco_elt *de;
 	struct deco_def_s *dd;
 	struct SYMBOL *s;
-	int f, staff, l;
+	int f, staff, l, dir, op;
 	char *gl, *p;
 	float x, y, y2, ym;
 	float ymid[MAXSTAFF];
@@ -1358,12 +1360,14 @@ void draw_all_deco(void)
 		// handle the stem direction
 		gl = ps_func_tb[f];		// glyph name(s)
 		p = strchr(gl, '/');
+		dir = 0;
 		if (p) {
 			if (de->s->stem >= 0) {
 				l = (int) (p - gl);
 			} else {
 				gl = p + 1;
 				l = strlen(gl);
+				dir = 1;
 			}
 		} else {
 			l = strlen(gl);
@@ -1486,9 +1490,19 @@ void draw_all_deco(void)
 				x = de->x - 20;
 			putxy(x, y);
 		}
-		if (de->flags & DE_INV)
+		if (de->flags & DE_INV) {
 			a2b("gsave 1 -1 scale neg %.*s grestore\n",
 					l, gl);
+			continue;
+		}
+		op = ps_op_tb[f][dir];
+		if (op == 0) {
+			op = op_find(gl, l);
+			op = op >= 0 ? op + 1 : -1;
+			ps_op_tb[f][dir] = op;
+		}
+		if (op > 0)
+			put_op(op - 1, '\n');
 		else
 			a2b("%.*s\n", l, gl);
 	}
@@ -2599,14 +2613,14 @@ void init_deco(void)
 /* reset the decoration table at start of a new tune */
 void reset_deco(void)
 {
-//	struct deco_def_s *dd;
-//	int ideco;
-//
-//	for (ideco = 1, dd = &deco_def_tb[1]; ideco < 128; ideco++, dd++) {
-//		if (!dd->name)
-//			break;
-//		free(dd->name);
-//	}
+	struct deco_def_s *dd;
+	int ideco;
+
+	for (ideco = 1, dd = &deco_def_tb[1]; ideco < 128; ideco++, dd++) {
+		if (!dd->name)
+			break;
+		free(dd->name);
+	}
 	memset(deco_def_tb, 0, sizeof deco_def_tb);
 }
 
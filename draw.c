@@ -15,6 +15,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
 
 #include "abcm2ps.h"
 
@@ -26,6 +27,27 @@ struct BEAM {			/* packages info on one beam */
 
 static char *acc_tb[] = { "", "sh", "nt", "ft", "dsh", "dft" };
 
+/* names of the drawing operations (same order as enum drawop) */
+char *drawop_nm[OP_NB] = {
+	"hd", "Hd", "HD", "HDD", "breve", "longa", "ghd", "custos",
+	"xydef", "pshhd", "pfthd", "r00", "r0", "r1", "r2", "r4",
+	"r8", "r16", "r32", "r64", "r128", "mrest", "mrep", "mrep2",
+	"srep", "showerror", "hl", "hl1", "hl2", "ghl", "tclef",
+	"cclef", "bclef", "pclef", "stclef", "scclef", "sbclef",
+	"spclef", "oct", "sh0", "ft0", "nt0", "csig", "ctsig",
+	"imsig", "iMsig", "pmsig", "pMsig", "tsig", "stsig", "su",
+	"sd", "gu", "gd", "sfu", "sfd", "sfs", "sgu", "sgd", "sgs",
+	"gua", "gda", "dt", "rdots", "bm", "trem", "bar", "thbar",
+	"dotbar", "brace", "bracket", "M", "RM", "RL", "stroke",
+	"SLW", "show", "showc", "showr", "wln", "hyph", "accent",
+	"arp", "brth", "coda", "cpu", "cresc", "dim", "dnb", "dplus",
+	"emb", "glisq", "gliss", "grm", "hld", "lmrd", "lphr", "ltr",
+	"marcato", "mphr", "o8va", "o8vb", "opend", "ped", "pedoff",
+	"sgno", "sld", "snap", "sphr", "stc", "thumb", "trl", "turn",
+	"turnx", "umrd", "upb", "wedge",
+};
+static int txt_out;		/* values as text (annotations) */
+
 /* scaling stuff */
 static int scale_voice;		/* staff (0) or voice(1) scaling */
 static float cur_scale = 1;	/* voice or staff scale */
@@ -61,7 +83,9 @@ static void anno_out(struct SYMBOL *s, char type)
 	if (mbf[-1] != '\n')
 		*mbf++ = '\n';
 	a2b("%%A %c %d %d ", type, s->linenum, s->colnum);
+	txt_out = 1;			/* (the SVG annotations are parsed) */
 	putxy(s->x - s->wl - 2, staff_tb[s->staff].y + s->ymn - 2);
+	txt_out = 0;
 	if (type != 'b' && type != 'e')		/* if not beam */
 		a2b("%.1f %d", s->wl + s->wr + 4, s->ymx - s->ymn + 4);
 	a2b("\n");
@@ -113,7 +137,8 @@ static struct SYMBOL *sym_dup(struct SYMBOL *s_orig)
 	int m;
 
 	s = (struct SYMBOL *) getarena(sizeof *s);
-	memcpy(s, s_orig, sizeof *s);
+	memset(s, 0, sizeof *s);
+	memcpy(s, s_orig, sym_size(s_orig));
 	s->flags |= ABC_F_INVIS;
 	s->text = NULL;
 	for (m = 0; m <= s->nhd; m++)
@@ -600,7 +625,7 @@ static void draw_beam(float x1,
 	putx(x2);
 	putf(dy2);
 	putxy(x1, y1);
-	a2b("bm\n");
+	put_op(OP_bm, '\n');
 }
 
 /* -- draw the beams for one word -- */
@@ -791,9 +816,11 @@ static void draw_sysbra(float x, int staff, int flag)
 				* staff_tb[staff].staffscale;
 	yb = staff_tb[end].y + staff_tb[end].botbar
 				* staff_tb[end].staffscale;
-	a2b("%.1f %.1f %.1f %s\n",
-	     yt - yb, x, yt,
-	     (flag & (CLOSE_BRACE | CLOSE_BRACE2)) ? "brace" : "bracket");
+	putf(yt - yb);
+	putf(x);
+	putf(yt);
+	put_op((flag & (CLOSE_BRACE | CLOSE_BRACE2)) ? OP_brace : OP_bracket,
+		'\n');
 }
 
 /* -- draw the left side of the staves -- */
@@ -827,9 +854,10 @@ static void draw_lstaff(float x)
 	set_sscale(-1);
 	yb = staff_tb[j].y + staff_tb[j].botbar
 				* staff_tb[j].staffscale;
-	a2b("%.1f %.1f %.1f bar\n",
-	     staff_tb[i].y + staff_tb[i].topbar * staff_tb[i].staffscale - yb,
-	     x, yb);
+	putf(staff_tb[i].y + staff_tb[i].topbar * staff_tb[i].staffscale - yb);
+	putf(x);
+	putf(yb);
+	put_op(OP_bar, '\n');
 	for (i = 0; i <= nst; i++) {
 		if (cursys->staff[i].flags & OPEN_BRACE)
 			draw_sysbra(x, i, CLOSE_BRACE);
@@ -863,25 +891,28 @@ static void draw_staff(int staff,
 					if (stafflines[i] != '|') {
 						if (thick != 1) {
 							if (thick >= 0)
-								a2b("stroke\n");
-							a2b("1.5 SLW ");
+								put_op(OP_stroke, '\n');
+							putf(1.5);
+							put_op(OP_SLW, ' ');
 							thick = 1;
 						}
 					} else {
 						if (thick != 0) {
 							if (thick >= 0)
-								a2b("stroke\n");
+								put_op(OP_stroke, '\n');
 							a2b("dlw ");
 							thick = 0;
 						}
 					}
 					putx(w);
 					putxy(x1, y);
-					a2b("M 0 RL ");
+					put_op(OP_M, ' ');
+					puti(0);
+					put_op(OP_RL, ' ');
 				}
 				y += 6;
 			}
-			a2b("stroke\n");
+			put_op(OP_stroke, '\n');
 			break;
 		}
 		y += 6;
@@ -893,7 +924,8 @@ static void draw_timesig(float x,
 			 struct SYMBOL *s)
 {
 	unsigned i, staff, l, l2;
-	char *f, meter[64];
+	int op;
+	char meter[64];
 	float dx, y;
 
 	if (s->u.meter.nmeter == 0)
@@ -909,7 +941,7 @@ static void draw_timesig(float x,
 			sprintf(meter, "(%.8s)(%.2s)",
 				s->u.meter.meter[i].top,
 				s->u.meter.meter[i].bot);
-			f = "tsig";
+			op = OP_tsig;
 			l2 = strlen(s->u.meter.meter[i].bot);
 			if (l2 > sizeof s->u.meter.meter[i].bot)
 				l2 = sizeof s->u.meter.meter[i].bot;
@@ -918,30 +950,30 @@ static void draw_timesig(float x,
 		} else switch (s->u.meter.meter[i].top[0]) {
 			case 'C':
 				if (s->u.meter.meter[i].top[1] != '|') {
-					f = "csig";
+					op = OP_csig;
 				} else {
-					f = "ctsig";
+					op = OP_ctsig;
 					l--;
 				}
 				dx = (float) (13 * l);
 				putxy(x - 5 + dx * .5, y + 12);
-				a2b("%s\n", f);
+				put_op(op, '\n');
 				x += dx;
 				continue;
 			case 'c':
 				if (s->u.meter.meter[i].top[1] != '.') {
-					f = "imsig";
+					op = OP_imsig;
 				} else {
-					f = "iMsig";
+					op = OP_iMsig;
 					l--;
 				}
 				meter[0] = '\0';
 				break;
 			case 'o':
 				if (s->u.meter.meter[i].top[1] != '.') {
-					f = "pmsig";
+					op = OP_pmsig;
 				} else {
-					f = "pMsig";
+					op = OP_pMsig;
 					l--;
 				}
 				meter[0] = '\0';
@@ -950,19 +982,19 @@ static void draw_timesig(float x,
 			case ')':
 				sprintf(meter, "(\\%s)",
 					s->u.meter.meter[i].top);
-				f = "stsig";
+				op = OP_stsig;
 				break;
 			default:
 				sprintf(meter, "(%.8s)",
 					s->u.meter.meter[i].top);
-				f = "stsig";
+				op = OP_stsig;
 				break;
 		}
 		if (meter[0] != '\0')
 			a2b("%s ", meter);
 		dx = (float) (13 * l);
 		putxy(x + dx * .5, y);
-		a2b("%s\n", f);
+		put_op(op, '\n');
 		x += dx;
 	}
 }
@@ -986,13 +1018,26 @@ static void draw_acc(int acc, int microscale)
 		if (acc >> 3 != 0
 		 && cfmt.nedo)		// %%MIDI temperamentequal <nedo>
 			n = ((((n >> 8) + 1) * 12) - 1) * 256 + cfmt.nedo - 1;
+		if (n == 0) {
+			switch (acc & 0x07) {
+			case A_SH:
+				put_op(OP_sh0, ' ');
+				return;
+			case A_NT:
+				put_op(OP_nt0, ' ');
+				return;
+			case A_FT:
+				put_op(OP_ft0, ' ');
+				return;
+			}
+		}
 		a2b("%s%d ", acc_tb[acc & 0x07], n);
 	}
 }
 
 // draw helper lines
 static void draw_hl(float x, float staffb, int up,
-		int y, char *stafflines, char *hltype)
+		int y, char *stafflines, int hltype)
 {
 	int i, l;
 
@@ -1007,7 +1052,7 @@ static void draw_hl(float x, float staffb, int up,
 		i = i * 6 - 6;
 		for ( ; i >= y; i -= 6) {
 			putxy(x, staffb + i);
-			a2b("%s ", hltype);
+			put_op(hltype, ' ');
 		}
 		return;
 	}
@@ -1016,7 +1061,7 @@ static void draw_hl(float x, float staffb, int up,
 	i = l * 6;
 	for ( ; i <= y; i += 6) {
 		putxy(x, staffb + i);
-		a2b("%s ", hltype);
+		put_op(hltype, ' ');
 	}
 }
 
@@ -1062,7 +1107,7 @@ static void draw_keysig(struct VOICE_S *p_voice,
 				p_seq = shift > 9 ? sharp1 : sharp2;
 				for (i = 0; i < old_sf; i++) {
 					putxy(x, staffb + shift);
-					a2b("nt0 ");
+					put_op(OP_nt0, ' ');
 					shift += *p_seq++;
 					x += 5.5;
 				}
@@ -1072,7 +1117,7 @@ static void draw_keysig(struct VOICE_S *p_voice,
 				p_seq = shift < 18 ? flat1 : flat2;
 				for (i = 0; i > old_sf; i--) {
 					putxy(x, staffb + shift);
-					a2b("nt0 ");
+					put_op(OP_nt0, ' ');
 					shift += *p_seq++;
 					x += 5.5;
 				}
@@ -1087,7 +1132,7 @@ static void draw_keysig(struct VOICE_S *p_voice,
 			p_seq = shift > 9 ? sharp1 : sharp2;
 			for (i = 0; i < s->u.key.sf; i++) {
 				putxy(x, staffb + shift);
-				a2b("sh0 ");
+				put_op(OP_sh0, ' ');
 				shift += *p_seq++;
 				x += 5.5;
 			}
@@ -1095,7 +1140,7 @@ static void draw_keysig(struct VOICE_S *p_voice,
 				x += 2;
 				for (; i < old_sf; i++) {
 					putxy(x, staffb + shift);
-					a2b("nt0 ");
+					put_op(OP_nt0, ' ');
 					shift += *p_seq++;
 					x += 5.5;
 				}
@@ -1108,7 +1153,7 @@ static void draw_keysig(struct VOICE_S *p_voice,
 			p_seq = shift < 18 ? flat1 : flat2;
 			for (i = 0; i > s->u.key.sf; i--) {
 				putxy(x, staffb + shift);
-				a2b("ft0 ");
+				put_op(OP_ft0, ' ');
 				shift += *p_seq++;
 				x += 5.5;
 			}
@@ -1116,7 +1161,7 @@ static void draw_keysig(struct VOICE_S *p_voice,
 				x += 2;
 				for (; i > old_sf; i--) {
 					putxy(x, staffb + shift);
-					a2b("nt0 ");
+					put_op(OP_nt0, ' ');
 					shift += *p_seq++;
 					x += 5.5;
 				}
@@ -1142,11 +1187,11 @@ static void draw_keysig(struct VOICE_S *p_voice,
 			if (shift < 0)
 				draw_hl(x, staffb, 0,
 					shift,		/* lower ledger line */
-					staff_tb[s->staff].stafflines, "hl");
+					staff_tb[s->staff].stafflines, OP_hl);
 			else if (shift > 24)
 				draw_hl(x, staffb, 1,
 					shift,		/* upper ledger line */
-					staff_tb[s->staff].stafflines, "hl");
+					staff_tb[s->staff].stafflines, OP_hl);
 			last_shift = shift;
 			putxy(x, staffb + shift);
 			draw_acc(acc, s->u.key.microscale);
@@ -1197,9 +1242,8 @@ static int bar_cnv(int bar_type)
 /* -- draw a measure bar -- */
 static void draw_bar(struct SYMBOL *s, float bot, float h)
 {
-	int staff, bar_type;
+	int staff, bar_type, op;
 	float x, yb;
-	char *psf;
 
 	staff = s->staff;
 	yb = staff_tb[staff].y;
@@ -1214,10 +1258,10 @@ static void draw_bar(struct SYMBOL *s, float bot, float h)
 			for (s2 = s->prev; s2->abc_type != ABC_T_REST; s2 = s2->prev)
 				;
 			putxy(s2->x, yb + 12);
-			a2b("mrep\n");
+			put_op(OP_mrep, '\n');
 		} else {
 			putxy(x, yb + 12);
-			a2b("mrep2\n");
+			put_op(OP_mrep2, '\n');
 			if (s->voice == cursys->top_voice) {
 /*fixme				set_font(s->gcf); */
 				set_font(cfmt.anf);
@@ -1239,16 +1283,16 @@ static void draw_bar(struct SYMBOL *s, float bot, float h)
 	if (bar_type == 0)
 		return;				/* invisible */
 	for (;;) {
-		psf = "bar";
+		op = OP_bar;
 		switch (bar_type & 0x07) {
 		case B_BAR:
 			if (s->u.bar.dotted)
-				psf = "dotbar";
+				op = OP_dotbar;
 			x -= 1;
 			break;
 		case B_OBRA:
 		case B_CBRA:
-			psf = "thbar";
+			op = OP_thbar;
 			x -= 3;
 			break;
 		case B_COL:
@@ -1258,12 +1302,15 @@ static void draw_bar(struct SYMBOL *s, float bot, float h)
 		switch (bar_type & 0x07) {
 		default:
 			set_sscale(-1);
-			a2b("%.1f %.1f %.1f %s ", h, x, bot, psf);
+			putf(h);
+			putf(x);
+			putf(bot);
+			put_op(op, ' ');
 			break;
 		case B_COL:
 			set_sscale(staff);
 			putxy(x + 1, staff_tb[staff].y);
-			a2b("rdots ");
+			put_op(OP_rdots, ' ');
 			break;
 		}
 		bar_type >>= 4;
@@ -1282,10 +1329,10 @@ static void draw_rest(struct SYMBOL *s)
 //	int no_head;
 	char *stafflines;
 	float x, dotx, staffb;
-	static char *rest_tb[NFLAGS_SZ] = {
-		"r128", "r64", "r32", "r16", "r8",
-		"r4",
-		"r2", "r1", "r0", "r00"
+	static const char rest_tb[NFLAGS_SZ] = {
+		OP_r128, OP_r64, OP_r32, OP_r16, OP_r8,
+		OP_r4,
+		OP_r2, OP_r1, OP_r0, OP_r00
 	};
 
 	/* don't display the rests of invisible staves */
@@ -1328,9 +1375,9 @@ static void draw_rest(struct SYMBOL *s)
 	if (s->sflags & S_REPEAT) {
 		putxy(x, staffb + 12);
 		if (s->doty < 0) {
-			a2b("srep\n");
+			put_op(OP_srep, '\n');
 		} else {
-			a2b("mrep\n");
+			put_op(OP_mrep, '\n');
 			if (s->doty > 2
 			 && s->voice == cursys->top_voice) {
 /*fixme				set_font(s->gcf); */
@@ -1352,8 +1399,10 @@ static void draw_rest(struct SYMBOL *s)
 		y -= 6;				/* semibreve a bit lower */
 
 	putxy(x, y + staffb);				/* rest */
-	a2b("%s ", s->u.note.notes[0].head ?
-			s->u.note.notes[0].head : rest_tb[i]);
+	if (s->u.note.notes[0].head)
+		a2b("%s ", s->u.note.notes[0].head);
+	else
+		put_op(rest_tb[i], ' ');
 
 	/* output ledger line(s) when greater than minim */
 	if (i >= 6) {
@@ -1362,7 +1411,7 @@ static void draw_rest(struct SYMBOL *s)
 		default:
 			if (j >= l - 1 || stafflines[j + 1] != '|') {
 				putxy(x, y + staffb);
-				a2b("hl1 ");
+				put_op(OP_hl1, ' ');
 			}
 			if (i == 9) {		// longa
 				y -= 6;
@@ -1377,13 +1426,15 @@ static void draw_rest(struct SYMBOL *s)
 		}
 		if (j >= l || stafflines[j] != '|') {
 			putxy(x, y + staffb);
-			a2b("hl1 ");
+			put_op(OP_hl1, ' ');
 		}
 	}
 
 	dotx = 8;
 	for (i = 0; i < s->dots; i++) {
-		a2b("%.1f 3 dt ", dotx);
+		putf(dotx);
+		puti(3);
+		put_op(OP_dt, ' ');
 		dotx += 3.5;
 	}
 	a2b("\n");
@@ -1428,7 +1479,7 @@ static void draw_gracenotes(struct SYMBOL *s)
 					y1 += 1;
 			}
 			putxy(x1, y1);
-			a2b("g%ca\n", g->stem > 0 ? 'u' : 'd');
+			put_op(g->stem > 0 ? OP_gua : OP_gda, '\n');
 		}
 		if (annotate
 		 && (g->sflags & (S_BEAM_ST | S_BEAM_END)) == S_BEAM_END)
@@ -1590,7 +1641,7 @@ static void draw_basic_note(float x,
 			    signed char *y_tb)
 {
 	struct note *note = &s->u.note.notes[m];
-	int y, head, dots, nflags, acc;
+	int y, head, dots, nflags, acc, op;
 //	int no_head;
 	int old_color = -1;
 	float staffb, shhd;
@@ -1635,39 +1686,50 @@ static void draw_basic_note(float x,
 		}
 		if (yy) {
 			putxy(x + shhd, yy + staffb);
-			a2b("hl ");
+			put_op(OP_hl, ' ');
 		}
 	}
 
 	/* draw the head */
+	op = -1;			/* (head as text) */
 	if (note->invisible) {
-		p = "xydef";
+		op = OP_xydef;
 	} else if ((p = note->head) != NULL) {
 		snprintf(hd, sizeof hd, "%.*s", note->hlen, p);
 		p = hd;
 		a2b("2 copy xydef ");		/* set x y */
 	} else if (s->flags & ABC_F_GRACE) {
-		p = "ghd";
+		op = OP_ghd;
 	} else if (s->type == CUSTOS) {
-		p = "custos";
+		op = OP_custos;
 	} else if ((s->sflags & S_PERC) && acc != 0) {
-		sprintf(hd, "p%shd", acc_tb[acc & 0x07]);
+		switch (acc & 0x07) {
+		case A_SH:
+			op = OP_pshhd;
+			break;
+		case A_FT:
+			op = OP_pfthd;
+			break;
+		default:
+			sprintf(hd, "p%shd", acc_tb[acc & 0x07]);
+			p = hd;
+			break;
+		}
 		acc = 0;
-		p = hd;
 	} else {
 		switch (head) {
 		case H_OVAL:
 			if (note->len < BREVE) {
-				p = "HD";
+				op = OP_HD;
 				break;
 			}
 			if (s->head != H_SQUARE) {
-				p = "HDD";
+				op = OP_HDD;
 				break;
 			}
 			/* fall thru */
 		case H_SQUARE:
-			p = note->len < BREVE * 2 ? "breve" : "longa";
+			op = note->len < BREVE * 2 ? OP_breve : OP_longa;
 
 			/* don't display dots on last note of the tune */
 			if (!tsnext && s->next
@@ -1675,16 +1737,19 @@ static void draw_basic_note(float x,
 				dots = 0;
 			break;
 		case H_EMPTY:
-			p = "Hd"; break;
+			op = OP_Hd; break;
 		default:
-			p = "hd"; break;
+			op = OP_hd; break;
 		}
 	}
 	if (note->color >= 0) {
 		old_color = cur_color;
 		set_color(note->color);
 	}
-	a2b("%s", p);
+	if (op >= 0)
+		put_op(op, 0);
+	else
+		a2b("%s", p);
 
 	/* draw the dots */
 /*fixme: to see for grace notes*/
@@ -1697,7 +1762,10 @@ static void draw_basic_note(float x,
 		if (scale_voice)
 			doty /= cur_scale;
 		while (--dots >= 0) {
-			a2b(" %.1f %d dt", dotx, doty);
+			a2b(" ");
+			putf(dotx);
+			puti(doty);
+			put_op(OP_dt, 0);
 			dotx += 3.5;
 		}
 	}
@@ -1725,9 +1793,8 @@ static void draw_note(float x,
 		      struct SYMBOL *s,
 		      int fl)
 {
-	int m, ma;
+	int m, ma, hltype;
 	float staffb, slen, shhd;
-	char c, *hltype;
 	signed char y_tb[MAXHD];
 
 	if (s->dots)
@@ -1739,17 +1806,17 @@ static void draw_note(float x,
 	/* output the ledger lines */
 	if (!(s->flags & ABC_F_INVIS)) {
 		if (s->flags & ABC_F_GRACE) {
-			hltype = "ghl";
+			hltype = OP_ghl;
 		} else {
 			switch (s->head) {
 			default:
-				hltype = "hl";
+				hltype = OP_hl;
 				break;
 			case H_OVAL:
-				hltype = "hl1";
+				hltype = OP_hl1;
 				break;
 			case H_SQUARE:
-				hltype = "hl2";
+				hltype = OP_hl2;
 				break;
 			}
 		}
@@ -1774,25 +1841,30 @@ static void draw_note(float x,
 
 	/* draw the stem and flags */
 	if (!(s->flags & (ABC_F_INVIS | ABC_F_STEMLESS))) {
-		char c2;
+		int op;
 
-		c = s->stem >= 0 ? 'u' : 'd';
 		slen = (s->ys - s->y) / voice_tb[s->voice].scale;
+		a2b(" ");
 		if (!fl || s->nflags - s->aux <= 0) {	/* stem only */
-			c2 = (s->flags & ABC_F_GRACE) ? 'g' : 's';
+			op = (s->flags & ABC_F_GRACE) ? OP_gu : OP_su;
+			if (s->stem < 0)
+				op++;			/* gd / sd */
 			if (s->nflags > 0) {	/* (fix for PS low resolution) */
 				if (s->stem >= 0)
 					slen -= 1;
 				else
 					slen += 1;
 			}
-			a2b(" %.1f %c%c", slen, c2, c);
 		} else {				/* stem and flags */
+			op = (s->flags & ABC_F_GRACE) ? OP_sgu : OP_sfu;
 			if (cfmt.straightflags)
-				c = 's';		/* straight flag */
-			c2 = (s->flags & ABC_F_GRACE) ? 'g' : 'f';
-			a2b(" %d %.1f s%c%c", s->nflags - s->aux, slen, c2, c);
+				op += 2;		/* straight flag */
+			else if (s->stem < 0)
+				op++;			/* flags down */
+			puti(s->nflags - s->aux);
 		}
+		putf(slen);
+		put_op(op, 0);
 	} else if (s->sflags & S_XSTEM) {	/* cross-staff stem */
 		struct SYMBOL *s2;
 
@@ -1801,7 +1873,9 @@ static void draw_note(float x,
 		slen += staff_tb[s2->staff].y - staffb;
 /*fixme:KO when different scales*/
 		slen /= voice_tb[s->voice].scale;
-		a2b(" %.1f su", slen);
+		a2b(" ");
+		putf(slen);
+		put_op(OP_su, 0);
 	}
 
 	/* draw the tremolo bars */
@@ -1829,9 +1903,10 @@ static void draw_note(float x,
 				slen -= 6 + 5.4;
 		}
 		slen /= voice_tb[s->voice].scale;
-		a2b(" %d ", s->aux);
+		a2b(" ");
+		puti(s->aux);
 		putxy(x1, staffb + slen);
-		a2b("trem");
+		put_op(OP_trem, 0);
 	}
 
 	/* draw the other note heads */
@@ -3744,7 +3819,8 @@ static void draw_lyric_line(struct VOICE_S *p_voice,
 				if (lflag) {
 					putx(x0 - lastx);
 					putx(lastx + 3);
-					a2b("y wln ");
+					a2b("y ");
+					put_op(OP_wln, ' ');
 					lflag = 0;
 					lastx = s->x + s->wr;
 				}
@@ -3774,7 +3850,8 @@ static void draw_lyric_line(struct VOICE_S *p_voice,
 			} else if (*p != LY_HYPH) {	/* not '-' */
 				putx(s->x - shift - lastx);
 				putx(lastx);
-				a2b("y hyph ");
+				a2b("y ");
+				put_op(OP_hyph, ' ');
 				hyflag = 0;
 				lastx = s->x + s->wr;
 			}
@@ -3783,7 +3860,8 @@ static void draw_lyric_line(struct VOICE_S *p_voice,
 		 && *p != LY_UNDER) {		/* not '_' */
 			putx(x0 - lastx + 3);
 			putx(lastx + 3);
-			a2b("y wln ");
+			a2b("y ");
+			put_op(OP_wln, ' ');
 			lflag = 0;
 			lastx = s->x + s->wr;
 		}
@@ -3815,7 +3893,8 @@ static void draw_lyric_line(struct VOICE_S *p_voice,
 			x0 = lastx + 10;
 		putx(x0 - lastx);
 		putx(lastx);
-		a2b("y hyph ");
+		a2b("y ");
+		put_op(OP_hyph, ' ');
 		if (cfmt.hyphencont)
 			p_voice->hy_st |= (1 << j);
 	}
@@ -3839,7 +3918,8 @@ static void draw_lyric_line(struct VOICE_S *p_voice,
 	if (lflag) {
 		putx(x0 - lastx + 3);
 		putx(lastx + 3);
-		a2b("y wln");
+		a2b("y ");
+		put_op(OP_wln, 0);
 	}
 	a2b("\n");
 }
@@ -4771,12 +4851,14 @@ static void draw_symbols(struct VOICE_S *p_voice)
 			y = staff_tb[staff].y;
 			x -= 10;		/* clef shift - see set_width() */
 			putxy(x, y + s->y);
-			if (s->u.clef.name)
+			if (s->u.clef.name) {
 				a2b("%s\n", s->u.clef.name);
-			else
-				a2b("%c%cclef\n",
-				     s->aux ? 's' : ' ',
-				     "tcbp"[(unsigned) s->u.clef.type]);
+			} else {
+				if (!s->aux)
+					a2b(" ");
+				put_op((s->aux ? OP_stclef : OP_tclef)
+						+ s->u.clef.type, '\n');
+			}
 			if (s->u.clef.octave != 0) {
 /*fixme:break the compatibility and avoid strange numbers*/
 				if (s->u.clef.octave > 0)
@@ -4784,7 +4866,7 @@ static void draw_symbols(struct VOICE_S *p_voice)
 				else
 					y += s->ymn;
 				putxy(x - 2, y);
-				a2b("oct\n");
+				put_op(OP_oct, '\n');
 			}
 			if (annotate)
 				anno_out(s, 'c');
@@ -4873,10 +4955,83 @@ void draw_all_symb(void)
 	}
 }
 
+/* -- output a value (* 10) in binary form in SVG -- */
+/* return 0 if the value cannot be coded */
+static int put_val(double v)
+{
+	int i;
+	char tmp[4];
+
+	if (!(v > -0x100000 && v < 0x100000))	/* (and NaN) */
+		return 0;
+	i = signbit(v) ? (1 << 20) | (int) -v : (int) v;
+	tmp[0] = SVG_VAL;
+	tmp[1] = 0x80 | (i >> 14);
+	tmp[2] = 0x80 | ((i >> 7) & 0x7f);
+	tmp[3] = 0x80 | (i & 0x7f);
+	a2b_raw(tmp, 4);
+	return 1;
+}
+
+/* -- format a value as "%.1f " -- */
+/* return the end of the string in the buffer */
+static char *f1a(char *p, float v)
+{
+	long n;
+	int l;
+	char tmp[16];
+
+	if (!(fabsf(v) < 2e8))		/* (v * 10 must fit in a 32-bit long) */
+		return p + sprintf(p, "%.1f ", v);
+	if (signbit(v)) {
+		*p++ = '-';
+		v = -v;
+	}
+	n = lrint(v * 10.);		/* exact, so same rounding as %.1f */
+	l = 0;
+	do {
+		tmp[l++] = '0' + n % 10;
+		n /= 10;
+	} while (n != 0 || l < 2);
+	while (l > 1)
+		*p++ = tmp[--l];
+	*p++ = '.';
+	*p++ = tmp[0];
+	*p++ = ' ';
+	return p;
+}
+
 /* -- output a floating value, and x and y according to the current scale -- */
 void putf(float v)
 {
-	a2b("%.1f ", v);
+	char tmp[64];
+
+	if ((svg || epsf > 1) && !txt_out
+	 && put_val(rint(v * 10.)))		/* same rounding as %.1f */
+		return;
+	a2b_raw(tmp, f1a(tmp, v) - tmp);
+}
+
+void puti(int v)
+{
+	char tmp[16], *p;
+	unsigned u;
+	int l;
+
+	if ((svg || epsf > 1) && !txt_out
+	 && put_val(v * 10.))
+		return;
+	p = tmp + sizeof tmp;
+	*--p = ' ';
+	u = v < 0 ? -(unsigned) v : (unsigned) v;
+	do {
+		*--p = '0' + u % 10;
+		u /= 10;
+	} while (u != 0);
+	if (v < 0)
+		*--p = '-';
+	l = tmp + sizeof tmp - p;
+	a2b_raw(p, l);
 }
 
 void putx(float x)
@@ -4884,21 +5039,61 @@ void putx(float x)
 	putf(x / cur_scale);
 }
 
-void puty(float y)
+static float ps_y(float y)
 {
-	putf(scale_voice ?
+	return scale_voice ?
 		y / cur_scale :		/* scaled voice */
-		y - cur_trans);		/* scaled staff */
+		y - cur_trans;		/* scaled staff */
+}
+
+void puty(float y)
+{
+	putf(ps_y(y));
 }
 
 void putxy(float x, float y)
 {
-	if (scale_voice)
-		a2b("%.1f %.1f ",
-		     x / cur_scale, y / cur_scale);	/* scaled voice */
+	char tmp[128];
+
+	if ((svg || epsf > 1) && !txt_out) {
+		putf(x / cur_scale);
+		putf(ps_y(y));
+		return;
+	}
+	a2b_raw(tmp, f1a(f1a(tmp, x / cur_scale), ps_y(y)) - tmp);
+}
+
+/* -- output a drawing operation -- */
+/* sep is the character to put after the operation name, or 0 */
+void put_op(int op, char sep)
+{
+	char tmp[3];
+
+	if (svg || epsf > 1) {
+		tmp[0] = SVG_OP;
+		tmp[1] = 0x80 | op;
+		tmp[2] = sep;
+		a2b_raw(tmp, sep ? 3 : 2);
+		return;
+	}
+	if (sep)
+		a2b("%s%c", drawop_nm[op], sep);
 	else
-		a2b("%.1f %.1f ",
-		     x / cur_scale, y - cur_trans);	/* scaled staff */
+		a2b("%s", drawop_nm[op]);
+}
+
+/* -- get the drawing operation from its name -- */
+/* return -1 if not found */
+int op_find(char *name, int len)
+{
+	int op;
+
+	for (op = 0; op < OP_NB; op++) {
+		if (strncmp(drawop_nm[op], name, len) == 0
+		 && drawop_nm[op][len] == '\0')
+			return op;
+	}
+	return -1;
 }
 
 /* -- set the voice or staff scale -- */
@@ -158,6 +158,10 @@ static struct format {
 	{0, 0, 0, 0}		/* end of table */
 };
 
+/* format_tb sorted by name for the keyword search */
+static struct format *fmt_idx[sizeof format_tb / sizeof format_tb[0]];
+static int nfmt;
+
 static const char helvetica[] = "Helvetica";
 static const char times[] = "Times-Roman";
 static const char times_bold[] = "Times-Bold";
@@ -319,6 +323,7 @@ void make_font_list(void)
 static void set_infoname(char *p)
 {
 	struct SYMBOL *s, *prev;
+	int old_lvl;
 
 	if (*p == 'I')
 		return;
@@ -339,6 +344,7 @@ static void set_infoname(char *p)
 		}
 		return;
 	}
+	old_lvl = lvlarena(0);		/* the list is shared by the tunes */
 	if (!s) {
 		s = (struct SYMBOL *) getarena(sizeof *s);
 		memset(s, 0, sizeof *s);
@@ -351,6 +357,7 @@ static void set_infoname(char *p)
 	}
 	s->text = (char *) getarena(strlen(p) + 1);
 	strcpy(s->text, p);
+	lvlarena(old_lvl);
 }
 
 /* -- set the default format -- */
@@ -476,6 +483,39 @@ void set_format(void)
 	set_infoname("H \"History: \"");
 }
 
+/* -- compare two format parameter names (qsort) -- */
+static int fmt_cmp(const void *a, const void *b)
+{
+	return strcmp((*(struct format **) a)->name,
+			(*(struct format **) b)->name);
+}
+
+/* -- search a format parameter by name -- */
+static struct format *get_fmt(char *w)
+{
+	struct format *fd;
+	int i, j, k, r;
+
+	if (nfmt == 0) {
+		for (fd = format_tb; fd->name; fd++)
+			fmt_idx[nfmt++] = fd;
+		qsort(fmt_idx, nfmt, sizeof fmt_idx[0], fmt_cmp);
+	}
+	i = 0;
+	j = nfmt - 1;
+	while (i <= j) {
+		k = (i + j) / 2;
+		r = strcmp(w, fmt_idx[k]->name);
+		if (r == 0)
+			return fmt_idx[k];
+		if (r < 0)
+			j = k - 1;
+		else
+			i = k + 1;
+	}
+	return NULL;
+}
+
 /* -- print the current format -- */
 void print_format(void)
 {
@@ -1133,9 +1173,7 @@ void interpret_fmt_line(char *w,		/* keyword */
 			return;
 		}
 		if (strcmp(w, "scale") == 0) {
-			for (fd = format_tb; fd->name; fd++)
-				if (strcmp("pagescale", fd->name) == 0)
-					break;
+			fd = get_fmt("pagescale");
 			if (fd->lock)
 				return;
 			fd->lock = lock;
@@ -1173,10 +1211,8 @@ void interpret_fmt_line(char *w,		/* keyword */
 		}
 		break;
 	}
-	for (fd = format_tb; fd->name; fd++)
-		if (strcmp(w, fd->name) == 0)
-			break;
-	if (!fd->name)
+	fd = get_fmt(w);
+	if (!fd)
 		return;
 
 	i = strlen(p);
@@ -1209,9 +1245,9 @@ void interpret_fmt_line(char *w,		/* keyword */
 			*((int *) fd->v) = get_bool(p);
 			if (fd->subtype == 3) {
 				if (cfmt.abc2pscompat)
-					deco['M'] = "tenuto";
+					deco_set('M', "tenuto");
 				else
-					deco['M'] = "lowermordent";
+					deco_set('M', "lowermordent");
 			}
 			break;
 		case 1:	{			/* %%writefields */
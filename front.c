@@ -16,6 +16,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <regex.h>
+#include <sys/stat.h>
 
 #ifdef WIN32
 #define strncasecmp _strnicmp
@@ -27,9 +28,35 @@
 static unsigned char *dst;
 static int offset, size;
 static unsigned char *selection;
+static regex_t sel_re;		/* compiled RE of the selection */
+static int sel_re_st;		/* 0: not compiled, 1: OK, -1: bad RE */
 static int latin, skip;
 static char prefix[4] = {'%'};
 static int state;
+static unsigned long long glob_hash = 0xcbf29ce484222325ULL;
+				/* hash of the definitions (tune cache) */
+
+/* tune index (-Y) */
+struct tidx_s {
+	long start;		/* offset of the X: line */
+	long end;		/* offset of the next empty line or of EOF */
+	int nlines;		/* number of lines between these offsets */
+	int hlen;		/* length of the tune header (X: .. K:) or -1
+				 * if the K: is not inside the tune */
+	int xnum;		/* tune number */
+};
+static struct tidx_s *tidx;	/* index of the next ABC file */
+static int ntidx;
+
+/* range of the next ABC file to treat (-J) */
+static long fe_start, fe_stop;	/* offsets - 0: no limit */
+
+/* streaming input (stdin) */
+#define FE_BUFSZ 65536
+static FILE *fe_fin;		/* stream of the next frontend() call */
+static unsigned char *fe_buf;	/* input buffer */
+static unsigned char *fe_end;	/* end of the data in the input buffer */
+static int fe_bufsz;
 
 /*
  * translation table from the ABC draft version 2
@@ -98,6 +125,92 @@ static unsigned char *latin_tb[5] = {
 	latin2, latin3, latin4, latin5, latin6
 };
 
+/* -- check if a line may change the next tunes (tune cache) -- */
+/* these are the definitions outside the tunes and the pseudo-comments */
+static int glob_def(unsigned char *s, int in_tune)
+{
+	if (*s == '%' && s[1] == '%')
+		return 1;
+	if (*s == 'I' && s[1] == ':')
+		return 1;
+	return !in_tune && (*s != 'X' || s[1] != ':');
+}
+
+/* -- check if the tune starting at 's' is in the cache (-C) -- */
+static int tune_cached(unsigned char *s)
+{
+	unsigned char *p, *q;
+	unsigned long long h;
+
+	/* the tune is skipped up to the first empty line (as with '-e'),
+	 * so, it must not contain blank lines, %%begin sequences
+	 * nor other tunes */
+	h = glob_hash;
+	for (p = s; *p != '\0'; p = q) {
+		if (*p == '\n' || *p == '\r')
+			break;				/* empty line */
+		for (q = p; *q == ' ' || *q == '\t'; q++)
+			;
+		if (*q == '\n' || *q == '\r' || *q == '\0'	/* blank line */
+		 || (p[0] == '%' && p[1] == '%'
+		  && strncmp((char *) p + 2, "begin", 5) == 0)
+		 || (p != s && p[0] == 'X' && p[1] == ':'))
+			return cache_get(0);
+		while (*q != '\0' && *q != '\n' && *q != '\r')
+			q++;
+		if (glob_def(p, 1))		/* same as in frontend() */
+			h = cache_hash(h, p, q - p);
+		if (*q == '\r')
+			q++;
+		if (*q == '\n')
+			q++;
+	}
+	if (!cache_get(cache_hash(glob_hash, s, p - s)))
+		return 0;
+	glob_hash = h;
+	return 1;
+}
+
+/* scan of the text by words
+ * HASZERO() is not null when one byte of the word is null
+ * HASBYTE() is not null when one byte of the word is 'c' */
+#define ONES (~0UL / 255)
+#define HIGHS (ONES * 0x80)
+#define HASZERO(w) (((w) - ONES) & ~(w) & HIGHS)
+#define HASBYTE(w, c) HASZERO((w) ^ (ONES * (c)))
+
+/* -- get the end of a line -- */
+/* 'end' points to the end of the text
+ * '*p_cnv' is set when the line contains characters to be converted */
+static unsigned char *line_end(unsigned char *p, unsigned char *end,
+				int *p_cnv)
+{
+	unsigned long w, high;
+	int cnv;
+
+	cnv = 0;
+	high = latin > 0 ? HIGHS : 0;
+	while (p + sizeof w <= end) {
+		memcpy(&w, p, sizeof w);
+		if (HASZERO(w) | HASBYTE(w, '\r') | HASBYTE(w, '\n'))
+			break;
+		if (HASBYTE(w, '\\') | HASBYTE(w, '%') | (w & high))
+			cnv = 1;
+		p += sizeof w;
+	}
+	while (*p != '\0'
+	    && *p != '\r'
+	    && *p != '\n') {
+		if (*p == '\\'
+		 || *p == '%'
+		 || (latin > 0 && *p >= 0x80))
+			cnv = 1;
+		p++;
+	}
+	*p_cnv = cnv;
+	return p;
+}
+
 /* add text to the output buffer */
 static void txt_add(unsigned char *s, int sz)
 {
@@ -111,7 +224,7 @@ static void txt_add(unsigned char *s, int sz)
 			dst = realloc(dst, size);
 		if (!dst) {
 			fprintf(stderr, "Out of memory - abort\n");
-			exit(EXIT_FAILURE);
+			fatal_exit();
 		}
 	}
 	memcpy(dst + offset, s, sz);
@@ -123,10 +236,24 @@ static void txt_add(unsigned char *s, int sz)
 static void txt_add_cnv(unsigned char *s, int sz, int comment)
 {
 	unsigned char *p, c, tmp[4];
+	unsigned long w, high;
 	int in_string = 0;
 
+	high = latin > 0 ? HIGHS : 0;
 	p = s;
 	while (sz > 0) {
+
+		/* skip the words without special characters */
+		while (sz >= (int) sizeof w) {
+			memcpy(&w, p, sizeof w);
+			if (HASBYTE(w, '"') | HASBYTE(w, '%')
+			 | HASBYTE(w, '\\') | (w & high))
+				break;
+			p += sizeof w;
+			sz -= sizeof w;
+		}
+		if (sz <= 0)
+			break;
 		switch (*p) {
 		case '"':
 			if (comment)
@@ -392,11 +519,38 @@ static void get_vers(char *p)
 	parse.abc_vers = (i << 16) + (j << 8) + k;
 }
 
+/* get the length of the tune header ('s' points to X:)
+ * return -1 if no K: */
+static int header_len(unsigned char *s)
+{
+	unsigned char *p;
+
+	for (p = s + 2; ; p++) {
+		switch (*p) {
+		case '\0':
+			return -1;
+		default:
+			continue;
+		case '\n':
+		case '\r':
+			break;
+		}
+		if (p[1] != 'K' || p[2] != ':')
+			continue;
+		p += 3;
+		while (*p != '\n' && *p != '\r' && *p != '\0')
+			p++;
+		if (*p != '\0')
+			p++;		/* keep the EOL for RE with '\s' */
+		break;
+	}
+	return p - s;
+}
+
 /* check if the current tune is to be selected */
-static int tune_select(unsigned char *s)
+static int tune_select(unsigned char *s, struct tidx_s *ti)
 {
-	regex_t r;
-	unsigned char *p, *sel;
+	unsigned char *sel;
 	int ret;
 
 	/* if there is a list of tune indexes,
@@ -406,7 +560,10 @@ static int tune_select(unsigned char *s)
 		int tune_number, cur_sel, end_sel, n;
 
 		/* get the tune number ('s' points to X:) */
-		tune_number = strtod((char *) s + 2, 0);
+		if (ti)
+			tune_number = ti->xnum;
+		else
+			tune_number = strtod((char *) s + 2, 0);
 
 		/* search it in the number list */
 		for (;;) {
@@ -432,27 +589,9 @@ static int tune_select(unsigned char *s)
 			return 0;
 	}
 
-	for (p = s + 2; ; p++) {
-		switch (*p) {
-		case '\0':
-			return 0;
-		default:
-			continue;
-		case '\n':
-		case '\r':
-			break;
-		}
-		if (p[1] != 'K' || p[2] != ':')
-			continue;
-		p += 3;
-		while (*p != '\n' && *p != '\r' && *p != '\0')
-			p++;
-		if (*p != '\0')
-			p++;		/* keep the EOL for RE with '\s' */
-		break;
-	}
-
-	ret = p - s;
+	ret = ti && ti->hlen >= 0 ? ti->hlen : header_len(s);
+	if (ret < 0)
+		return 0;
 	if (ret >= TEX_BUF_SZ - 1) {
 		fprintf(stderr, "Tune header too big for %%%%select\n");
 		return 0;
@@ -460,13 +599,286 @@ static int tune_select(unsigned char *s)
 	memcpy(tex_buf, s, ret);
 	tex_buf[ret] = '\0';
 
-	ret = regcomp(&r, (char *) sel,
-				REG_EXTENDED | REG_NEWLINE | REG_NOSUB);
-	if (ret)
+	/* compile the RE at first use */
+	if (sel_re_st == 0) {
+		if (regcomp(&sel_re, (char *) sel,
+				REG_EXTENDED | REG_NEWLINE | REG_NOSUB) == 0)
+			sel_re_st = 1;
+		else
+			sel_re_st = -1;
+	}
+	if (sel_re_st < 0)
 		return 0;
-	ret = regexec(&r, tex_buf, 0, NULL, 0);
-	regfree(&r);
-	return !ret;
+	return regexec(&sel_re, tex_buf, 0, NULL, 0) == 0;
+}
+
+/* -- build the index of the tunes of an ABC file -- */
+static void tidx_build(unsigned char *file)
+{
+	unsigned char *s, *p;
+	int i, max, open, linenum;
+
+	max = 0;
+	open = -1;			/* first tune without end */
+	linenum = 0;
+	for (s = file; *s != '\0'; s = p) {
+		linenum++;
+		if (*s == 'X' && s[1] == ':') {
+
+			/* a tune without empty line ends at the next X: */
+			for (i = open; i >= 0 && i < ntidx; i++) {
+				tidx[i].end = s - file;
+				tidx[i].nlines = linenum - tidx[i].nlines - 1;
+			}
+			open = -1;
+			if (ntidx >= max) {
+				max = max ? max * 2 : 256;
+				tidx = realloc(tidx, max * sizeof *tidx);
+				if (!tidx) {
+					fprintf(stderr, "Out of memory - abort\n");
+					fatal_exit();
+				}
+			}
+			open = ntidx;
+			tidx[ntidx].start = s - file;
+			tidx[ntidx].nlines = linenum;
+			tidx[ntidx].hlen = header_len(s);
+			tidx[ntidx].xnum = strtod((char *) s + 2, 0);
+			ntidx++;
+		}
+
+		/* get the next line as in frontend() */
+		p = s;
+		while (*p != '\0'
+		    && *p != '\r'
+		    && *p != '\n')
+			p++;
+		if (p == s && open >= 0) {	/* empty line: end of tunes */
+			for (i = open; i < ntidx; i++) {
+				tidx[i].end = s - file;
+				tidx[i].nlines = linenum - tidx[i].nlines - 1;
+			}
+			open = -1;
+		}
+		if (*p != '\0') {
+			p++;
+			if (p[-1] == '\r' && *p == '\n')
+				p++;
+		}
+	}
+	if (open >= 0) {
+		for (i = open; i < ntidx; i++) {
+			tidx[i].end = s - file;
+			tidx[i].nlines = linenum - tidx[i].nlines;
+		}
+	}
+
+	/* keep the header length only when the K: is inside the tune */
+	for (i = 0; i < ntidx; i++) {
+		if (tidx[i].start + tidx[i].hlen > tidx[i].end)
+			tidx[i].hlen = -1;
+	}
+}
+
+/* -- get a field of the tune header for the index file -- */
+static int tidx_field(unsigned char *s, int hlen, int c, unsigned char **p_f)
+{
+	unsigned char *p, *e;
+
+	e = s + hlen;
+	for (p = s; p < e; ) {
+		if (*p == c && p[1] == ':') {
+			p += 2;
+			while (*p == ' ' || *p == '\t')
+				p++;
+			*p_f = p;
+			while (p < e && *p != '\n' && *p != '\r'
+			    && *p != '\t' && *p != '\0')
+				p++;
+			return p - *p_f;
+		}
+		while (p < e && *p != '\n' && *p != '\r')
+			p++;
+		while (p < e && (*p == '\n' || *p == '\r'))
+			p++;
+	}
+	*p_f = s;
+	return 0;
+}
+
+/* -- decode a line of the index file -- */
+static int tidx_line(char *p, struct tidx_s *ti)
+{
+	char *q;
+	long v[5];
+	int i;
+
+	for (i = 0; i < 5; i++) {
+		v[i] = strtol(p, &q, 10);
+		if (q == p)
+			return 0;
+		p = q;
+	}
+	ti->start = v[0];
+	ti->end = v[1];
+	ti->nlines = v[2];
+	ti->hlen = v[3];
+	ti->xnum = v[4];
+	return 1;
+}
+
+/* -- load or create the tune index of an ABC file (-Y) -- */
+/* the index is kept in the file '<ABC file>.idx' */
+void tune_index(unsigned char *file, char *fn)
+{
+	struct stat sbuf;
+	struct tidx_s *ti;
+	FILE *f;
+	unsigned char *t, *k;
+	long long size, fmtime;
+	int i, n, lt, lk;
+	char idxfn[FILENAME_MAX], tmp[FILENAME_MAX + 16], line[256];
+
+	free(tidx);
+	tidx = NULL;
+	ntidx = 0;
+	if (stat(fn, &sbuf) != 0
+	 || strlen(fn) + 5 > sizeof idxfn)
+		return;
+	sprintf(idxfn, "%s.idx", fn);
+
+	/* check if the index file is up to date */
+	f = fopen(idxfn, "r");
+	if (f) {
+		if (fgets(line, sizeof line, f)
+		 && sscanf(line, "%%abcm2ps-index %lld %lld %d",
+				&size, &fmtime, &n) == 3
+		 && size == (long long) sbuf.st_size
+		 && fmtime == (long long) sbuf.st_mtime
+		 && n >= 0) {
+			tidx = malloc((n + 1) * sizeof *tidx);
+			for (i = 0, ti = tidx; tidx && i < n; i++, ti++) {
+				if (!fgets(line, sizeof line, f)
+				 || !tidx_line(line, ti)
+				 || ti->start < 0
+				 || ti->end <= ti->start
+				 || ti->end > size
+				 || (i > 0 && ti->start < ti[-1].end)
+				 || ti->nlines < 0
+				 || ti->hlen < -1
+				 || ti->start + ti->hlen > ti->end)
+					break;
+
+				/* skip the title and key */
+				while (!strchr(line, '\n')
+				    && fgets(line, sizeof line, f))
+					;
+			}
+			if (tidx && i == n) {
+				ntidx = n;
+				fclose(f);
+				return;
+			}
+			free(tidx);
+			tidx = NULL;
+		}
+		fclose(f);
+	}
+
+	/* build the index and save it */
+	/* (the new index is renamed when complete, so that the other
+	 *  processes (-J) see either the old or the new one) */
+	tidx_build(file);
+	snprintf(tmp, sizeof tmp, "%s.%d.tmp", idxfn, out_id);
+	f = fopen(tmp, "w");
+	if (!f)
+		return;
+	fprintf(f, "%%abcm2ps-index %lld %lld %d\n",
+		(long long) sbuf.st_size, (long long) sbuf.st_mtime, ntidx);
+	for (i = 0, ti = tidx; i < ntidx; i++, ti++) {
+		t = file + ti->start;
+		lt = tidx_field(t, ti->hlen, 'T', &t);
+		k = file + ti->start;
+		lk = tidx_field(k, ti->hlen, 'K', &k);
+		fprintf(f, "%ld %ld %d %d %d\t%.*s\t%.*s\n",
+			ti->start, ti->end, ti->nlines, ti->hlen, ti->xnum,
+			lt, t, lk, k);
+	}
+	if (fclose(f) != 0 || rename(tmp, idxfn) != 0)
+		remove(tmp);
+}
+
+/* -- set the range of the tunes to treat in the next ABC file (-J) -- */
+/* the tunes before 'start' are skipped, but not the global definitions,
+ * and the file is treated up to 'stop' (0: EOF) */
+void frontend_range(long start, long stop)
+{
+	fe_start = start;
+	fe_stop = stop;
+}
+
+/* -- read more data from the input stream -- */
+/* the data from 's' are moved at the start of the buffer */
+/* return the number of bytes read */
+static int fe_refill(unsigned char *s, FILE *fin)
+{
+	int l, n;
+
+	l = fe_end - s;
+	memmove(fe_buf, s, l);
+	if (l >= fe_bufsz / 2) {		/* long line */
+		fe_bufsz *= 2;
+		fe_buf = realloc(fe_buf, fe_bufsz);
+		if (!fe_buf) {
+			fprintf(stderr, "Out of memory - abort\n");
+			fatal_exit();
+		}
+	}
+	n = fread(fe_buf + l, 1, fe_bufsz - l - 1, fin);
+	if (n <= 0 && ferror(fin))
+		fprintf(stderr, "Read error on the input stream\n");
+	fe_end = fe_buf + l + n;
+	*fe_end = '\0';
+	return n;
+}
+
+/* -- check if the end of a tune is in the input buffer -- */
+static int fe_tune_full(unsigned char *p)
+{
+	unsigned char *q;
+
+	for (;;) {
+		if (*p == '\r' && p[1] == '\n')
+			p++;
+		if (*p != '\0')
+			p++;			/* skip the EOL */
+		for (q = p; *q != '\0' && *q != '\r' && *q != '\n'; q++)
+			;
+		if (q == fe_end)
+			return 0;
+		if (q == p)
+			return 1;		/* empty line */
+		p = q;
+	}
+}
+
+/* -- front end parser of a stream -- */
+/* the stream is read by blocks, so that the tunes are generated
+ * as soon as they are complete */
+void frontend_stream(FILE *fin, char *fname)
+{
+	if (!fe_buf) {
+		fe_bufsz = FE_BUFSZ;
+		fe_buf = malloc(fe_bufsz);
+		if (!fe_buf) {
+			fprintf(stderr, "Out of memory - abort\n");
+			fatal_exit();
+		}
+	}
+	fe_end = fe_buf;
+	fe_refill(fe_buf, fin);
+	fe_fin = fin;
+	frontend(fe_buf, FE_ABC, fname, 0);
 }
 
 /* -- front end parser -- */
@@ -478,8 +890,33 @@ void frontend(unsigned char *s,
 	unsigned char *p, *q, c, *begin_end, sep;
 	int i, l, str_cnv_p, histo, end_len;
 	char prefix_sav[4];
-	int latin_sav = 0;		/* have C compiler happy */
+	int latin_sav;
+	struct tidx_s *idx, *ti;
+	int nidx, cidx;
+	unsigned char *base;
+	FILE *fin;
+	unsigned char *end, begin_tag[32];
+	long start, stop;
+
+	/* get the input stream, the tune index and the range of this file */
+	fin = fe_fin;
+	fe_fin = NULL;
+	idx = tidx;
+	nidx = ntidx;
+	cidx = 0;
+	tidx = NULL;
+	ntidx = 0;
+	base = s;
+	start = stop = 0;
+	if (ftype == FE_ABC && !fin) {
+		start = fe_start;
+		stop = fe_stop;
+		fe_start = fe_stop = 0;
+	}
 
+	/* (the previous file may have ended inside a tune) */
+	memcpy(prefix_sav, prefix, sizeof prefix_sav);
+	latin_sav = latin;
 	begin_end = NULL;
 	end_len = 0;
 	histo = 0;
@@ -500,13 +937,25 @@ void frontend(unsigned char *s,
 		linenum++;
 	}
 
+	end = fin ? fe_end : s + strlen((char *) s);
+
 	/* if unknown encoding, check if latin1 or utf-8 */
 	if (ftype == FE_ABC
 	 && parse.abc_vers >= ((2 << 16) | (1 << 8))) {	// if ABC version >= 2.1
 		latin = 0;				// always UTF-8
 	} else {
+		unsigned long w;
+
 		for (p = s; *p != '\0'; p++) {
+			while (p + sizeof w <= end) {	/* skip the ASCII words */
+				memcpy(&w, p, sizeof w);
+				if (HASBYTE(w, '\\') | (w & HIGHS))
+					break;
+				p += sizeof w;
+			}
 			c = *p;
+			if (c == '\0')
+				break;
 			if (c == '\\') {
 				if (!isdigit(p[1]))
 					continue;
@@ -532,19 +981,36 @@ void frontend(unsigned char *s,
 
 	/* scan the file */
 	skip = 0;
-	while (*s != '\0') {
+	while (*s != '\0'
+	    || (fin && s == fe_end)) {
+
+		/* check the range of the tunes */
+		if (stop != 0 && s - base >= stop)
+			break;
+		if (start != 0 && s - base >= start) {
+			start = 0;
+			job_range_start();
+		}
 
 		/* get a line */
-		str_cnv_p = 0;
-		p = s;
-		while (*p != '\0'
-		    && *p != '\r'
-		    && *p != '\n') {
-			if (*p == '\\'
-			 || *p == '%'
-			 || (latin > 0 && *p >= 0x80))
-				str_cnv_p = 1;
-			p++;
+		p = line_end(s, end, &str_cnv_p);
+
+		/* if streaming and no full line or tune, read more data */
+		if (fin
+		 && (p == fe_end
+		  || (*p == '\r' && p + 1 == fe_end)
+		  || (*s == 'X' && s[1] == ':' && !fe_tune_full(p)))) {
+			if (begin_end && begin_end != begin_tag) {
+				if (end_len >= (int) sizeof begin_tag)
+					end_len = sizeof begin_tag - 1;
+				memcpy(begin_tag, begin_end, end_len);
+				begin_end = begin_tag;
+			}
+			if (fe_refill(s, fin) <= 0)
+				fin = NULL;		/* EOF */
+			s = fe_buf;
+			end = fe_end;
+			continue;
 		}
 		l = p - s;
 		if (*p != '\0') {
@@ -559,6 +1025,11 @@ void frontend(unsigned char *s,
 				goto ignore;
 			skip = 0;
 		}
+
+		/* the global definitions may change the next tunes */
+		if (cachedir
+		 && (begin_end || glob_def(s, state != 0)))
+			glob_hash = cache_hash(glob_hash, s, l);
 		if (begin_end) {
 			if (ftype == FE_FMT) {
 				if (strncmp((char *) s, "end", 3) == 0
@@ -681,7 +1152,7 @@ void frontend(unsigned char *s,
 					s++;
 					l--;
 				}
-				for (i = 0; i < sizeof prefix - 1; i++) {
+				for (i = 0; i < (int) sizeof prefix - 1; i++) {
 					if (*s == ' ' || *s == '\t'
 					 || --l < 0)
 						break;
@@ -808,6 +1279,9 @@ pcinfo:
 					free(selection);
 					selection = NULL;
 				}
+				if (sel_re_st > 0)
+					regfree(&sel_re);
+				sel_re_st = 0;
 				if (q != s) {
 					sep = *q;
 					*q = '\0';
@@ -830,6 +1304,10 @@ info:
 				l -= 2;
 				goto pscom;
 			case 'X':
+				if (start != 0) {	/* before the range */
+					skip = 1;
+					goto ignore;
+				}
 				switch (state) {
 				case 1:
 					fprintf(stderr,
@@ -844,9 +1322,30 @@ info:
 					break;
 				}
 				if (selection) {
-					skip = !tune_select(s);
-					if (skip)
+					ti = NULL;
+					while (cidx < nidx
+					    && idx[cidx].start < s - base)
+						cidx++;
+					if (cidx < nidx
+					 && idx[cidx].start == s - base)
+						ti = &idx[cidx];
+					skip = !tune_select(s, ti);
+					if (skip) {
+						if (ti) {	/* go to the end of the tune */
+							p = base + ti->end;
+							linenum += ti->nlines;
+						}		/* (and skip up to an empty line) */
 						goto ignore;
+					}
+				}
+				if (cachedir && epsf == 2 && state == 0
+				 && tune_cached(s)) {
+					skip = 1;
+					state = 2;	/* as if the tune was treated
+							 * (it may end at EOF) */
+					strcpy(prefix_sav, prefix);
+					latin_sav = latin;
+					goto ignore;
 				}
 				state = 1;
 				strcpy(prefix_sav, prefix);
@@ -892,6 +1391,7 @@ next_eol:
 ignore:
 		s = p;
 	}
+	free(idx);
 	if (begin_end)
 		fprintf(stderr,
 			"Line %d: No %%%%end after %%%%begin\n",
@@ -0,0 +1,46 @@
+/*
+ * libabcm2ps: abcm2ps as a library
+ *
+ * Copyright (C) 1998-2019 Jean-François Moine (http://moinejf.free.fr)
+ *
+ * abcm2ps is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef LIBABCM2PS_H
+#define LIBABCM2PS_H
+
+/* output types */
+#define ABCM2PS_PS	0	/* PostScript */
+#define ABCM2PS_SVG	1	/* SVG, one image per page (-v) */
+#define ABCM2PS_SVG_TUNE 2	/* SVG, one image per tune (-g) */
+#define ABCM2PS_XHTML	3	/* XHTML+SVG (-X) */
+
+struct abcm2ps_opts {
+	int output;		/* output type */
+	const char *fmtdir;	/* format directory (-D) or NULL */
+	const char **fmt;	/* format files (-F), NULL terminated, or NULL */
+	const char **param;	/* format parameters (--name value),
+				 * name/value pairs, NULL terminated, or NULL */
+	int (*write)(void *ctx, const char *buf, int len);
+				/* output function - returns 'len' or -1 */
+	void (*end)(void *ctx);	/* end of a page or tune image (SVG)
+				 * or of a document (PS, XHTML), or NULL */
+	void *ctx;		/* user data for 'write' and 'end' */
+};
+
+/* initialize the library - must be called once */
+int abcm2ps_init(const struct abcm2ps_opts *opts);
+
+/* generate the music of some ABC text
+ * return 0 when OK or -1 on errors
+ * after a fatal error (no memory, output error), the library cannot
+ * be used anymore and all the calls return -1 */
+int abcm2ps_render(const char *abc, int len);
+
+/* treat a command line as the program abcm2ps */
+int abcm2ps_main(int argc, char **argv);
+
+#endif
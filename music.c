@@ -1748,7 +1748,8 @@ static void set_repeat(struct SYMBOL *g,	/* repeat format */
 		}
 		g->nohdi1 = 1;
 		s = (struct SYMBOL *) getarena(sizeof *s);
-		memcpy(s, g, sizeof *s);
+		memset(s, 0, sizeof *s);
+		memcpy(s, g, sym_size(g));
 		s->next = s2->extra;
 		if (s->next)
 			s->next->prev = s;
@@ -5046,7 +5047,7 @@ static void error_show(void)
 	for (s = tsfirst; s; s = s->ts_next) {
 		if (s->flags & ABC_F_ERROR) {
 			putxy(s->x, staff_tb[s->staff].y + s->y);
-			a2b("showerror\n");
+			put_op(OP_showerror, '\n');
 		}
 	}
 }
@@ -5054,26 +5055,37 @@ static void error_show(void)
 /* -- delay output until the staves are defined (by draw_systems) -- */
 static float delayed_output(float indent)
 {
+	static char *dbuf;		/* buffer of the delayed output */
+	static int dbufsz;
 	float line_height;
-	char *outbuf_sav, *mbf_sav, *tmpbuf;
+	char *outbuf_sav, *mbf_sav;
+	int outbufsz_sav, l;
 
+	if (!dbuf) {
+		dbufsz = outbufsz;
+		dbuf = malloc(dbufsz);
+		if (!dbuf) {
+			error(1, NULL, "Out of memory for delayed outbuf - abort");
+			fatal_exit();
+		}
+	}
 	outbuf_sav = outbuf;
 	mbf_sav = mbf;
-	tmpbuf = malloc(outbufsz);
-	if (!tmpbuf) {
-		error(1, NULL, "Out of memory for delayed outbuf - abort");
-		exit(EXIT_FAILURE);
-	}
-	mbf = outbuf = tmpbuf;
+	outbufsz_sav = outbufsz;
+	mbf = outbuf = dbuf;
+	outbufsz = dbufsz;
 	*outbuf = '\0';
 	outft = -1;
 	draw_sym_near();
+	dbuf = outbuf;			/* (may have grown) */
+	dbufsz = outbufsz;
+	l = mbf - outbuf;
 	outbuf = outbuf_sav;
+	outbufsz = outbufsz_sav;
 	mbf = mbf_sav;
 	outft = -1;
 	line_height = draw_systems(indent);
-	a2b("%s", tmpbuf);
-	free(tmpbuf);
+	a2b_raw(dbuf, l);
 	return line_height;
 }
 
@@ -5087,7 +5099,6 @@ void output_music(void)
 	gen_init();
 	if (!tsfirst)
 		return;
-	check_buffer();
 	set_global();			/* initialize the generator */
 	if (first_voice->next) {	/* if many voices */
 //		if (cfmt.combinevoices >= 0)
@@ -34,11 +34,15 @@ struct brk_s {				/* music line break */
 struct voice_opt_s {			/* voice options */
 	struct voice_opt_s *next;
 	struct SYMBOL *s;		/* list of options (%%xxx) */
+	regex_t r;			/* compiled voice RE */
+	int r_ok;			/* 'r' is valid */
 };
 struct tune_opt_s {			/* tune options */
 	struct tune_opt_s *next;
 	struct voice_opt_s *voice_opts;
 	struct SYMBOL *s;		/* list of options (%%xxx) */
+	regex_t r;			/* compiled tune RE */
+	int r_ok;			/* 'r' is valid */
 };
 
 int nstaff;				/* (0..MAXSTAFF-1) */
@@ -61,7 +65,8 @@ static struct symsel_s clip_start, clip_end;
 
 static INFO info_glob;			/* global info definitions */
 static char *deco_glob[256];		/* global decoration table */
-static struct map *maps_glob;		/* save note maps */
+static struct map *maps_glob;		/* global note maps */
+static char deco_saved;			/* deco[] saved in the tune */
 
 static int over_time;			/* voice overlay start time */
 static int over_mxtime;			/* voice overlay max time */
@@ -512,7 +517,8 @@ static void voice_compress(void)
 				while (!(s->flags & ABC_F_GR_END))
 					s = s->next;
 				s2 = (struct SYMBOL *) getarena(sizeof *s);
-				memcpy(s2, s, sizeof *s2);
+				memset(s2, 0, sizeof *s2);
+				memcpy(s2, s, sym_size(s));
 				s2->abc_type = 0;
 				s2->type = GRACE;
 				s2->dur = 0;
@@ -600,7 +606,8 @@ static void voice_dup(void)
 			if (s->type == STAVES)
 				continue;
 			s2 = (struct SYMBOL *) getarena(sizeof *s2);
-			memcpy(s2, s, sizeof *s2);
+			memset(s2, 0, sizeof *s2);
+			memcpy(s2, s, sym_size(s));
 			s2->prev = p_voice2->last_sym;
 			s2->next = NULL;
 			if (p_voice2->sym)
@@ -623,14 +630,16 @@ static void voice_dup(void)
 			if (!g)
 				continue;
 			g2 = (struct SYMBOL *) getarena(sizeof *g2);
-			memcpy(g2, g, sizeof *g2);
+			memset(g2, 0, sizeof *g2);
+			memcpy(g2, g, sym_size(g));
 			s2->extra = g2;
 			s2 = g2;
 			s2->voice = voice;
 			s2->staff = p_voice2->staff;
 			for (g = g->next; g; g = g->next) {
 				g2 = (struct SYMBOL *) getarena(sizeof *g2);
-				memcpy(g2, g, sizeof *g2);
+				memset(g2, 0, sizeof *g2);
+				memcpy(g2, g, sym_size(g));
 				s2->next = g2;
 				g2->prev = s2;
 				s2 = g2;
@@ -2625,8 +2634,10 @@ static void put_pdfmark(char *p)
 static char *tune_header_rebuild(struct SYMBOL *s)
 {
 	struct SYMBOL *s2;
-	char *header, *p;
+	char *p;
 	int len;
+	static char *header;
+	static int header_sz;
 
 	len = 0;
 	s2 = s;
@@ -2638,7 +2649,11 @@ static char *tune_header_rebuild(struct SYMBOL *s)
 		}
 		s2 = s2->abc_next;
 	}
-	header = malloc(len + 1);
+	if (len + 1 > header_sz) {
+		header_sz = (len + 1 + 1023) / 1024 * 1024;
+		free(header);
+		header = malloc(header_sz);
+	}
 	p = header;
 	for (;;) {
 		if (s->abc_type == ABC_T_INFO) {
@@ -2659,24 +2674,14 @@ static void tune_filter(struct SYMBOL *s)
 {
 	struct tune_opt_s *opt;
 	struct SYMBOL *s1, *s2;
-	regex_t r;
-	char *header, *p;
-	int ret;
+	char *header;
 
 	header = tune_header_rebuild(s);
 	for (opt = tune_opts; opt; opt = opt->next) {
 		struct SYMBOL *last_staves;
 
-		p = &opt->s->text[2 + 5];	/* "%%tune RE" */
-		while (isspace((unsigned char) *p))
-			p++;
-
-		ret = regcomp(&r, p, REG_EXTENDED | REG_NEWLINE | REG_NOSUB);
-		if (ret)
-			continue;
-		ret = regexec(&r, header, 0, NULL, 0);
-		regfree(&r);
-		if (ret)
+		if (!opt->r_ok
+		 || regexec(&opt->r, header, 0, NULL, 0) != 0)
 			continue;
 
 		/* apply the options */
@@ -2703,14 +2708,14 @@ static void tune_filter(struct SYMBOL *s)
 				continue;
 			}
 			s2 = (struct SYMBOL *) getarena(sizeof *s2);
-			memcpy(s2, s1, sizeof *s2);
+			memset(s2, 0, sizeof *s2);
+			memcpy(s2, s1, sym_size(s1));
 			process_pscomment(s2);
 		}
 		cur_tune_opts = NULL;
 		tune_voice_opts = opt->voice_opts;	// for %%voice
 //fixme: what if many %%tune's with %%voice inside?
 	}
-	free(header);
 }
 
 /* apply the options of the current voice */
@@ -2718,9 +2723,7 @@ static void voice_filter(void)
 {
 	struct voice_opt_s *opt;
 	struct SYMBOL *s;
-	regex_t r;
 	int pass, ret;
-	char *p;
 
 	/* scan the global, then the tune options */
 	pass = 0;
@@ -2734,17 +2737,11 @@ static void voice_filter(void)
 				break;
 			pass++;
 		}
-		p = &opt->s->text[2 + 6];	/* "%%voice RE" */
-		while (isspace((unsigned char) *p))
-			p++;
-
-		ret = regcomp(&r, p, REG_EXTENDED | REG_NOSUB);
-		if (ret)
+		if (!opt->r_ok)
 			goto next_voice;
-		ret = regexec(&r, curvoice->id, 0, NULL, 0);
+		ret = regexec(&opt->r, curvoice->id, 0, NULL, 0);
 		if (ret && curvoice->nm)
-			ret = regexec(&r, curvoice->nm, 0, NULL, 0);
-		regfree(&r);
+			ret = regexec(&opt->r, curvoice->nm, 0, NULL, 0);
 		if (ret)
 			goto next_voice;
 
@@ -2753,7 +2750,8 @@ static void voice_filter(void)
 			struct SYMBOL *s2;
 
 			s2 = (struct SYMBOL *) getarena(sizeof *s2);
-			memcpy(s2, s, sizeof *s2);
+			memset(s2, 0, sizeof *s2);
+			memcpy(s2, s, sym_size(s));
 			process_pscomment(s2);
 		}
 next_voice:
@@ -2855,18 +2853,18 @@ static struct SYMBOL *get_global_def(struct SYMBOL *s)
 	return s;
 }
 
-/* save the global note maps */
-static void save_maps(void)
+/* -- copy the note maps before their first change in a tune -- */
+static void tune_maps(void)
 {
 	struct map *omap, *map;
 	struct note_map *onotes, *notes;
 
+	if (maps != maps_glob)
+		return;
 	omap = maps;
-	if (!omap) {
-		maps_glob = NULL;
+	if (!omap)
 		return;
-	}
-	maps_glob = map = getarena(sizeof *maps_glob);
+	maps = map = getarena(sizeof *maps);
 	for (;;) {
 		memcpy(map, omap, sizeof *map);
 		onotes = omap->notes;
@@ -2889,6 +2887,23 @@ static void save_maps(void)
 	}
 }
 
+/* -- change a decoration of deco[] -- */
+/* (the global table is saved on the first change in a tune) */
+void deco_set(int c, char *name)
+{
+	if (info['X' - 'A'] && !deco_saved) {
+		memcpy(deco_glob, deco, sizeof deco_glob);
+		deco_saved = 1;
+	}
+	deco[c] = name;
+}
+
+/* -- set a user decoration (U: / %%user) -- */
+static void set_user(struct SYMBOL *s)
+{
+	deco_set(s->u.user.symbol, parse.deco_tb[s->u.user.value - 128]);
+}
+
 /* -- identify info line, store in proper place	-- */
 static struct SYMBOL *get_info(struct SYMBOL *s)
 {
@@ -3072,7 +3087,7 @@ static struct SYMBOL *get_info(struct SYMBOL *s)
 		break;
 	case 'U':
 		if (s->u.user.value)	// if no error
-			deco[s->u.user.symbol] = parse.deco_tb[s->u.user.value - 128];
+			set_user(s);
 		break;
 	case 'u':
 		break;
@@ -3123,8 +3138,7 @@ static struct SYMBOL *get_info(struct SYMBOL *s)
 
 		memcpy(&dfmt, &cfmt, sizeof dfmt); /* save global values */
 		memcpy(&info_glob, &info, sizeof info_glob);
-		memcpy(deco_glob, deco, sizeof deco_glob);
-		save_maps();
+		maps_glob = maps;		/* (deco[] and maps saved on change) */
 		info['X' - 'A'] = s;
 		if (tune_opts)
 			tune_filter(s);
@@ -3427,10 +3441,10 @@ void do_tune(void)
 {
 	struct VOICE_S *p_voice;
 	struct SYMBOL *s, *s1, *s2;
-	int i;
+	int i, old_lvl;
 
 	/* initialize */
-	lvlarena(0);
+	lvlarena(1);			/* the tune data are freed with the tune */
 	nstaff = 0;
 	staves_found = -1;
 	for (i = 0; i < MAXVOICE; i++) {
@@ -3514,7 +3528,9 @@ void do_tune(void)
 			s = get_info(s);
 			break;
 		case ABC_T_PSCOM:
+			old_lvl = lvlarena(s->state != ABC_S_GLOBAL);
 			s = process_pscomment(s);
+			lvlarena(old_lvl);
 			break;
 		case ABC_T_NOTE:
 		case ABC_T_REST:
@@ -3663,7 +3679,10 @@ void do_tune(void)
 	if (info['X' - 'A']) {
 		memcpy(&cfmt, &dfmt, sizeof cfmt); /* restore global values */
 		memcpy(&info, &info_glob, sizeof info);
-		memcpy(deco, deco_glob, sizeof deco);
+		if (deco_saved) {
+			memcpy(deco, deco_glob, sizeof deco);
+			deco_saved = 0;
+		}
 		maps = maps_glob;
 		info['X' - 'A'] = NULL;
 	}
@@ -3680,6 +3699,7 @@ void do_tune(void)
 		}
 		brks = brk;		/* (NULL) */
 	}
+	lvlarena(0);
 }
 
 /* check if a K: or M: may go to the tune key and time signatures */
@@ -4883,11 +4903,26 @@ static void free_voice_opt(struct voice_opt_s *opt)
 
 	while (opt) {
 		opt2 = opt->next;
+		if (opt->r_ok)
+			regfree(&opt->r);
 		free(opt);
 		opt = opt2;
 	}
 }
 
+/* compile the regular expression of a %%tune or %%voice */
+static int opt_regcomp(regex_t *r, struct SYMBOL *s, int flags)
+{
+	char *p;
+
+	p = &s->text[2];		/* skip "%%" and the keyword */
+	while (!isspace((unsigned char) *p) && *p != '\0')
+		p++;
+	while (isspace((unsigned char) *p))
+		p++;
+	return regcomp(r, p, flags) == 0;
+}
+
 // get a color
 static int get_color(char *p)
 {
@@ -5388,6 +5423,8 @@ static struct SYMBOL *process_pscomment(struct SYMBOL *s)
 		break;
 	case 'm':
 		if (strcmp(w, "map") == 0) {
+			if (s->state != ABC_S_GLOBAL)
+				tune_maps();
 			get_map(p);
 			return s;
 		}
@@ -5878,6 +5915,8 @@ center:
 				while (opt) {
 					free_voice_opt(opt->voice_opts);
 					opt2 = opt->next;
+					if (opt->r_ok)
+						regfree(&opt->r);
 					free(opt);
 					opt = opt2;
 				}
@@ -5916,6 +5955,8 @@ center:
 						tune_opts = opt->next;
 					else
 						opt2->next = opt->next;
+					if (opt->r_ok)
+						regfree(&opt->r);
 					free(opt);
 					return s;
 				}
@@ -5927,6 +5968,8 @@ center:
 				memset(opt, 0, sizeof *opt);
 				opt->next = tune_opts;
 				tune_opts = opt;
+				opt->r_ok = opt_regcomp(&opt->r, s,
+					REG_EXTENDED | REG_NEWLINE | REG_NOSUB);
 			}
 
 			/* link the options */
@@ -5955,7 +5998,7 @@ center:
 		break;
 	case 'u':
 		if (strcmp(w, "user") == 0) {
-			deco[s->u.user.symbol] = parse.deco_tb[s->u.user.value - 128];
+			set_user(s);
 			return s;
 		}
 		break;
@@ -6022,6 +6065,8 @@ center:
 					} else {
 						opt2->next = opt->next;
 					}
+					if (opt->r_ok)
+						regfree(&opt->r);
 					free(opt);
 					break;
 				}
@@ -6031,6 +6076,8 @@ center:
 				return s;
 			opt = malloc(sizeof *opt + strlen(p));
 			memset(opt, 0, sizeof *opt);
+			opt->r_ok = opt_regcomp(&opt->r, s,
+						REG_EXTENDED | REG_NOSUB);
 			if (cur_tune_opts) {
 				opt->next = cur_tune_opts->voice_opts;
 				cur_tune_opts->voice_opts = opt;
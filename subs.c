@@ -74,7 +74,7 @@ void bug(char *msg, int fatal)
 	error(1, NULL, "Internal error: %s.", msg);
 	if (fatal) {
 		fprintf(stderr, "Emergency stop.\n\n");
-		exit(EXIT_FAILURE);
+		fatal_exit();
 	}
 	fprintf(stderr, "Trying to continue...\n");
 }
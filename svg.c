@@ -31,6 +31,8 @@ enum elt_t {			/* element types */
 	STR,
 	SEQ,			/* {..} */
 	BRK,			/* [..] */
+	NAME,			/* executable name */
+	MRK,			/* '{' or '[' mark (in u.v) */
 };
 struct elt_s {
 	struct elt_s *next;
@@ -39,25 +41,96 @@ struct elt_s {
 		float v;
 		char *s;
 		struct elt_s *e;
+		struct ps_sym_s *sym;
 	} u;
 };
-struct ps_sym_s {
+struct ps_sym_s {		/* interned name */
+	struct ps_sym_s *next;	/* hash linkage */
 	char *n;		/* name */
-	struct elt_s *e;	/* value */
+	struct elt_s *e;	/* value (NULL if not defined) */
+	struct ps_code *code;	/* compiled value if {..} */
+	int ncode;		/* number of instructions */
 	int exec;		/* current number of execution */
+	short op;		/* built-in operator (-1 if none) */
+};
+struct ps_code {		/* compiled procedure instruction */
+	char type;		/* VAL, NAME or else push a copy of u.e */
+	union {
+		float v;
+		struct ps_sym_s *sym;
+		struct elt_s *e;
+	} u;
+};
+
+/* PostScript built-in operators */
+/* (the drawing operations are the first ones - see enum drawop) */
+enum ps_op {
+	PS_bang = OP_NB,	/* "!" = def */
+	PS_def, PS_bdef,
+	PS_abs, PS_add, PS_and, PS_anshow, PS_arc, PS_arcn, PS_atan,
+	PS_bind, PS_bitshift, PS_bnum, PS_bnumb, PS_box, PS_boxdraw,
+	PS_boxmark, PS_boxend, PS_C, PS_curveto, PS_closepath,
+	PS_composefont, PS_copy, PS_cos, PS_crdc, PS_currentgray,
+	PS_currentpoint, PS_cvi, PS_cvx, PS_dacs, PS_dacoda, PS_div,
+	PS_dSL, PS_dup, PS_dft0, PS_dsh0, PS_eofill, PS_eq, PS_exch,
+	PS_exec, PS_false, PS_fill, PS_findfont, PS_fng, PS_for,
+	PS_forall, PS_ft1, PS_ft4, PS_ft513, PS_gcshow, PS_ge, PS_get,
+	PS_getinterval, PS_gt, PS_grestore, PS_gsave, PS_gsl, PS_gxshow,
+	PS_idiv, PS_if, PS_ifelse, PS_index, PS_jshow, PS_L, PS_lineto,
+	PS_le, PS_lt, PS_length, PS_load, PS_lyshow, PS_moveto, PS_mod,
+	PS_mul, PS_ne, PS_neg, PS_newpath, PS_or, PS_pf, PS_pop,
+	PS_pdshhd, PS_pdfthd, PS_RC, PS_rcurveto, PS_rlineto,
+	PS_rmoveto, PS_roll, PS_repbra, PS_repeat, PS_rotate, PS_SL,
+	PS_scale, PS_scalefont, PS_search, PS_selectfont, PS_sep0,
+	PS_setdash, PS_setfont, PS_setgray, PS_setlinewidth, PS_sfz,
+	PS_showb, PS_setrgbcolor, PS_sub, PS_sh1, PS_sh4, PS_sh513,
+	PS_stringwidth, PS_svg, PS_T, PS_translate, PS_true, PS_tubr,
+	PS_tubrl, PS_where, PS_xymove,
+	PS_NB
+};
+
+static const char *ps_op_nm[PS_NB - OP_NB] = {
+	"!", "def", "bdef",
+	"abs", "add", "and", "anshow", "arc", "arcn", "atan", "bind",
+	"bitshift", "bnum", "bnumb", "box", "boxdraw", "boxmark",
+	"boxend", "C", "curveto", "closepath", "composefont", "copy",
+	"cos", "crdc", "currentgray", "currentpoint", "cvi", "cvx",
+	"dacs", "dacoda", "div", "dSL", "dup", "dft0", "dsh0",
+	"eofill", "eq", "exch", "exec", "false", "fill", "findfont",
+	"fng", "for", "forall", "ft1", "ft4", "ft513", "gcshow", "ge",
+	"get", "getinterval", "gt", "grestore", "gsave", "gsl",
+	"gxshow", "idiv", "if", "ifelse", "index", "jshow", "L",
+	"lineto", "le", "lt", "length", "load", "lyshow", "moveto",
+	"mod", "mul", "ne", "neg", "newpath", "or", "pf", "pop",
+	"pdshhd", "pdfthd", "RC", "rcurveto", "rlineto", "rmoveto",
+	"roll", "repbra", "repeat", "rotate", "SL", "scale",
+	"scalefont", "search", "selectfont", "sep0", "setdash",
+	"setfont", "setgray", "setlinewidth", "sfz", "showb",
+	"setrgbcolor", "sub", "sh1", "sh4", "sh513", "stringwidth",
+	"svg", "T", "translate", "true", "tubr", "tubrl", "where",
+	"xymove",
 };
 
 /* -- PostScript tiny interpreter -- */
 #define NELTS 2048	/* number of elements per block */
-#define NSYMS 512	/* max number of symbols */
+#define NHASH 1024	/* size of the symbol hash table (power of 2) */
+#define NCODE 4096	/* number of instructions per code block */
 static struct elt_s *elts;
 static struct elt_s *stack, *free_elt;
-static struct ps_sym_s ps_sym[NSYMS];
-static int n_sym;
+static struct ps_sym_s *ps_hash[NHASH];
+static struct ps_sym_s *sym_x, *sym_y;	/* 'x' and 'y' */
+static struct ps_sym_s *sym_exit;
+static struct ps_sym_s *op_sym[OP_NB];	/* drawing operations */
+static struct code_blk {		/* compiled procedures */
+	struct code_blk *next;
+	int n;				/* number of used instructions */
+	struct ps_code c[NCODE];
+} *code_blk;
 static int ps_error;
 static int in_cnt;			/* in [..] or {..} */
-static char *path;
-static char path_buf[256];
+static char *path;			/* current path (NULL if none) */
+static char *path_buf;			/* path buffer */
+static int path_len, path_sz;		/* length and size of path_buf */
 
 /* graphical context */
 static struct gc {
@@ -729,6 +802,7 @@ void svg_font_switch(void)
 
 /* PS functions */
 static void ps_exec(char *op);
+static void ps_sym_exec(struct ps_sym_s *sym);
 
 static void elts_link(struct elt_s *e)
 {
@@ -793,6 +867,8 @@ static void elt_free(struct elt_s *e)
 	switch (e->type) {
 	case STR:
 		free(e->u.s);
+		/* fall thru */
+	case NAME:
 		e->type = VAL;
 		e->u.v = 0;
 		break;
@@ -825,6 +901,9 @@ static struct elt_s *elt_dup(struct elt_s *e)
 	case STR:
 		e2->u.s = strdup(e->u.s);
 		break;
+	case NAME:
+		e2->u.sym = e->u.sym;
+		break;
 	case SEQ:
 	case BRK:
 		e = e->u.e;
@@ -865,6 +944,12 @@ static void elt_dump(struct elt_s *e)
 		if (e->u.s[0] == '(')
 			fprintf(stderr, ")");
 		break;
+	case NAME:
+		fprintf(stderr, " %s", e->u.sym->n);
+		break;
+	case MRK:
+		fprintf(stderr, " %c", (int) e->u.v);
+		break;
 	case SEQ:
 	case BRK:
 		fprintf(stderr, type == SEQ ? " {" : " [");
@@ -885,41 +970,142 @@ static void elt_lst_dump(struct elt_s *e)
 	} while (e);
 }
 
+/* get the interned name, creating it if needed */
+static struct ps_sym_s *ps_intern(char *name)
+{
+	struct ps_sym_s *ps;
+	unsigned char *p;
+	unsigned h;
+
+	h = 0;
+	for (p = (unsigned char *) name; *p != '\0'; p++)
+		h = h * 31 + *p;
+	h &= NHASH - 1;
+	for (ps = ps_hash[h]; ps; ps = ps->next) {
+		if (strcmp(ps->n, name) == 0)
+			return ps;
+	}
+	ps = calloc(1, sizeof *ps);
+	if (!ps) {
+		fprintf(stderr, "Out of memory.\n");
+		fatal_exit();
+	}
+	ps->n = strdup(name);
+	ps->op = -1;
+	ps->next = ps_hash[h];
+	ps_hash[h] = ps;
+	return ps;
+}
+
+/* remove all the symbol definitions */
+/* (the values are freed by elts_reset()) */
+static void ps_sym_reset(void)
+{
+	struct ps_sym_s *ps;
+	struct code_blk *blk;
+	int i;
+
+	for (i = 0; i < NHASH; i++) {
+		for (ps = ps_hash[i]; ps; ps = ps->next) {
+			ps->e = NULL;
+			ps->code = NULL;
+			ps->exec = 0;
+		}
+	}
+	while (code_blk) {
+		blk = code_blk->next;
+		free(code_blk);
+		code_blk = blk;
+	}
+	if (!sym_x) {
+		sym_x = ps_intern("x");
+		sym_y = ps_intern("y");
+		sym_exit = ps_intern("exit");
+		for (i = 0; i < OP_NB; i++) {
+			op_sym[i] = ps_intern(drawop_nm[i]);
+			op_sym[i]->op = i;
+		}
+		for (i = OP_NB; i < PS_NB; i++)
+			ps_intern((char *) ps_op_nm[i - OP_NB])->op = i;
+	}
+}
+
+/* get a defined symbol */
 static struct ps_sym_s *ps_sym_lookup(char *name)
 {
 	struct ps_sym_s *ps;
 
-	if (n_sym == 0)
-		return NULL;
-	ps = &ps_sym[n_sym];
-	for (;;) {
-		ps--;
-		if (strcmp(ps->n, name) == 0)
+	ps = ps_intern(name);
+	return ps->e ? ps : NULL;
+}
+
+/* compile a procedure
+ * the instructions are freed by ps_sym_reset()
+ * 'old' is the previous code of the symbol, reused when big enough */
+static void ps_compile(struct ps_sym_s *ps, struct ps_code *old)
+{
+	struct elt_s *e;
+	struct ps_code *c;
+	int n;
+
+	ps->code = NULL;
+	if (ps->e->type != SEQ)
+		return;
+	n = 0;
+	for (e = ps->e->u.e; e; e = e->next)
+		n++;
+	if (n > NCODE)
+		return;				/* too big: not compiled */
+	if (old && n <= ps->ncode) {
+		c = ps->code = old;
+	} else if (!code_blk || code_blk->n + n > NCODE) {
+		struct code_blk *blk;
+
+		blk = malloc(sizeof *blk);
+		if (!blk)
+			return;
+		blk->next = code_blk;
+		blk->n = 0;
+		code_blk = blk;
+	}
+	if (!ps->code) {
+		c = ps->code = &code_blk->c[code_blk->n];
+		code_blk->n += n;
+	}
+	ps->ncode = n;
+	for (e = ps->e->u.e; e; e = e->next, c++) {
+		switch (e->type) {
+		case VAL:
+			c->type = VAL;
+			c->u.v = e->u.v;
+			break;
+		case NAME:
+			c->type = NAME;
+			c->u.sym = e->u.sym;
+			break;
+		default:
+			c->type = e->type;
+			c->u.e = e;
 			break;
-		if (ps == ps_sym)
-			return NULL;
+		}
 	}
-	return ps;
 }
 
 static struct ps_sym_s *ps_sym_def(char *name, struct elt_s *e)
 {
 	struct ps_sym_s *ps;
+	struct ps_code *old;
 
-	ps = ps_sym_lookup(name);
-	if (ps) {
+	ps = ps_intern(name);
+	old = NULL;
+	if (ps->e && ps->exec == 0) {
 		elt_free(ps->e);
-	} else {
-		if (n_sym >= NSYMS) {
-			fprintf(stderr, "svg: Too many PS symbols\n");
-			ps_error = 1;
-			return NULL;
-		}
-		ps = &ps_sym[n_sym++];
-		ps->n = strdup(name);
+		old = ps->code;
 	}
+	/* (when the symbol is running, its old value and code are still
+	 *  in use - they are freed by elts_reset() and ps_sym_reset()) */
 	ps->e = e;
-	ps->exec = 0;
+	ps_compile(ps, old);
 	return ps;
 }
 
@@ -1067,6 +1253,105 @@ static void cond(int type)
 	}
 }
 
+/* format a value as "%.2f"
+ * (the value must be lower than 1e9) */
+static char *f2a(char *p, double v)
+{
+	long long n;
+	int l;
+	char tmp[24];
+
+	/* a float multiplied by 100 is exact in a double,
+	 * so rounding it gives the same result as printf() */
+	if (v != (float) v)
+		return p + sprintf(p, "%.2f", v);
+	if (signbit(v)) {
+		*p++ = '-';
+		v = -v;
+	}
+	n = llrint(v * 100);
+	l = 0;
+	do {
+		tmp[l++] = '0' + n % 10;
+		n /= 10;
+	} while (n != 0 || l < 3);
+	while (l > 2)
+		*p++ = tmp[--l];
+	*p++ = '.';
+	*p++ = tmp[1];
+	*p++ = tmp[0];
+	return p;
+}
+
+/* formatted output to the SVG file
+ * "%.2f", "%d", "%s" and "%c" are treated here, the other
+ * conversions by the libc */
+static void svg_printf(const char *fmt, ...)
+{
+	va_list args;
+	char buf[512], *p, *s;
+	double v;
+	int i;
+
+	va_start(args, fmt);
+	p = buf;
+	for ( ; *fmt != '\0'; fmt++) {
+		if (p > &buf[sizeof buf - 64]) {
+			fwrite(buf, 1, p - buf, fout);
+			p = buf;
+		}
+		if (*fmt != '%') {
+			*p++ = *fmt;
+			continue;
+		}
+		switch (fmt[1]) {
+		case '.':
+			if (fmt[2] != '2' || fmt[3] != 'f')
+				break;
+			v = va_arg(args, double);
+			if (fabs(v) < 1e9) {
+				p = f2a(p, v);
+			} else {
+				fwrite(buf, 1, p - buf, fout);
+				fprintf(fout, "%.2f", v);
+				p = buf;
+			}
+			fmt += 3;
+			continue;
+		case 'd':
+			p += sprintf(p, "%d", va_arg(args, int));
+			fmt++;
+			continue;
+		case 's':
+			s = va_arg(args, char *);
+			i = strlen(s);
+			if (i > &buf[sizeof buf] - p) {
+				fwrite(buf, 1, p - buf, fout);
+				fwrite(s, 1, i, fout);
+				p = buf;
+			} else {
+				memcpy(p, s, i);
+				p += i;
+			}
+			fmt++;
+			continue;
+		case 'c':
+			*p++ = va_arg(args, int);
+			fmt++;
+			continue;
+		case '%':
+			*p++ = '%';
+			fmt++;
+			continue;
+		}
+		break;
+	}
+	fwrite(buf, 1, p - buf, fout);
+	if (*fmt != '\0')
+		vfprintf(fout, fmt, args);
+	va_end(args);
+}
+
 /* output a xml string */
 static void xml_str_out(char *p)
 {
@@ -1112,7 +1397,7 @@ static void gen_info(void)
 #else
 	strftime(tex_buf, TEX_BUF_SZ, "%b %#d, %Y %H:%M", localtime(&ltime));
 #endif
-	fprintf(fout, "<!-- CreationDate: %s -->\n"
+	svg_printf("<!-- CreationDate: %s -->\n"
 			"<!-- CommandLine:",
 			tex_buf);
 
@@ -1162,12 +1447,12 @@ static void define_head(float w, float h)
 		"</style>\n"
 		"<title>";
 
-	fprintf(fout, svg_head1, w, h);
+	svg_printf(svg_head1, w, h);
 	if (cfmt.musicfont) {
 		if (strchr(cfmt.musicfont, '('))
-			fprintf(fout, svg_font_style_url, cfmt.musicfont);
+			svg_printf(svg_font_style_url, cfmt.musicfont);
 		else
-			fprintf(fout, svg_font_style, cfmt.musicfont);
+			svg_printf(svg_font_style, cfmt.musicfont);
 	}
 	fputs(svg_head2, fout);
 }
@@ -1194,13 +1479,13 @@ void define_svg_symbols(char *title, int num, float w, float h)
 				"<meta name=\"generator\" content=\"abcm2ps-" VERSION "\"/>\n",
 				fout);
 			gen_info();
-			fprintf(fout,
+			svg_printf(
 				"<style type=\"text/css\">\n"
 				"\tbody {margin:0; padding:0; border:0;");
 			if (cfmt.bgcolor && cfmt.bgcolor[0] != '\0')
-				fprintf(fout, " background-color:%s",
+				svg_printf(" background-color:%s",
 						cfmt.bgcolor);
-			fprintf(fout,
+			svg_printf(
 				"}\n"
 				"\t@page {margin: 0}\n"
 				"\tsvg {display: block}\n"
@@ -1214,14 +1499,14 @@ void define_svg_symbols(char *title, int num, float w, float h)
 		}
 		define_head(w, h);
 		xml_str_out(title);
-		fprintf(fout, svg_head3, "page", num);
+		svg_printf(svg_head3, "page", num);
 //		if (cfmt.bgcolor && cfmt.bgcolor[0] != '\0')
-//			fprintf(fout,
+//			svg_printf(
 //				"<rect width=\"100%%\" height=\"100%%\" fill=\"%s\"/>\n",
 //				cfmt.bgcolor);
 	} else {				/* -g, -v or -z */
 		if (epsf != 3) {
-			if (fout != stdout)
+			if (fout != fstdout)
 				fputs("<?xml version=\"1.0\" standalone=\"no\"?>\n"
 					"<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\"\n"
 					"\t\"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n",
@@ -1231,11 +1516,11 @@ void define_svg_symbols(char *title, int num, float w, float h)
 		}
 		define_head(w, h);
 		xml_str_out(title);
-		fprintf(fout, svg_head3, epsf ? "tune" : "page", num);
+		svg_printf(svg_head3, epsf ? "tune" : "page", num);
 		fputs("<!-- Creator: abcm2ps-" VERSION " -->\n", fout);
 		gen_info();
 		if (cfmt.bgcolor && cfmt.bgcolor[0] != '\0')
-			fprintf(fout,
+			svg_printf(
 				"<rect width=\"100%%\" height=\"100%%\" fill=\"%s\"/>\n",
 				cfmt.bgcolor);
 	}
@@ -1260,10 +1545,11 @@ void define_svg_symbols(char *title, int num, float w, float h)
 		return;
 
 	elts_reset();
-	n_sym = 0;
+	ps_sym_reset();
 
 	in_cnt = 0;
 	path = NULL;
+	path_len = 0;
 	ps_error = 0;
 
 	s = strdup("/defl 0 def\n"
@@ -1283,17 +1569,17 @@ static void output_font(int span)
 	 && (span || !gcur.rgb))
 		return;
 
-	fprintf(fout, " style=\"");
+	svg_printf(" style=\"");
 
 	if (!span && gcur.rgb) {
-		fprintf(fout, "color:#%06x;", gcur.rgb);
+		svg_printf("color:#%06x;", gcur.rgb);
 		if (gcur.font_n[0] == '\0') {
-			fprintf(fout, "\"");
+			svg_printf("\"");
 			return;
 		}
 	}
 
-	fprintf(fout, "font:");
+	svg_printf("font:");
 	fn = gcur.font_n;
 	if (fn[0] == '/')
 		fn++;
@@ -1303,29 +1589,29 @@ static void output_font(int span)
 		imin = p - fn;
 	p = strstr(fn, "old");
 	if (p && (p[-1] == 'B' || p[-1] == 'b')) {
-		fprintf(fout, "bold ");
+		svg_printf("bold ");
 		i = p - fn - 1;
 		if (imin > i)
 			imin = i;
 	}
 	p = strstr(fn, "talic");
 	if (p && (p[-1] == 'I' || p[-1] == 'i')) {
-		fprintf(fout, "italic ");
+		svg_printf("italic ");
 		i = p - fn - 1;
 		if (imin > i)
 			imin = i;
 	}
 	p = strstr(fn, "blique");
 	if (p && (p[-1] == 'O' || p[-1] == 'o')) {
-		fprintf(fout, "oblique ");
+		svg_printf("oblique ");
 		i = p - fn - 1;
 		if (imin > i)
 			imin = i;
 	}
 	if (strchr(fn, ' '))
-		fprintf(fout, "%.2fpx '%.*s'\"", gcur.font_s, imin, fn);
+		svg_printf("%.2fpx '%.*s'\"", gcur.font_s, imin, fn);
 	else
-		fprintf(fout, "%.2fpx %.*s\"", gcur.font_s, imin, fn);
+		svg_printf("%.2fpx %.*s\"", gcur.font_s, imin, fn);
 }
 
 static float strw(char *s)
@@ -1348,14 +1634,14 @@ static void setg(int newg);
 static void defg1(void)
 {
 	setg(0);
-	fprintf(fout, "<g stroke-width=\"%.2f\"", gcur.linewidth);
+	svg_printf("<g stroke-width=\"%.2f\"", gcur.linewidth);
 	if (gcur.xscale != 1 || gcur.yscale != 1 || gcur.rotate != 0) {
-		fprintf(fout, " transform=\"");
+		svg_printf(" transform=\"");
 		if (gcur.xscale != 1 || gcur.yscale != 1) {
 			if (gcur.xscale == gcur.yscale)
-				fprintf(fout, "scale(%.3f)", gcur.xscale);
+				svg_printf("scale(%.3f)", gcur.xscale);
 			else
-				fprintf(fout, "scale(%.3f,%.3f)",
+				svg_printf("scale(%.3f,%.3f)",
 						gcur.xscale, gcur.yscale);
 		}
 		if (gcur.rotate != 0) {
@@ -1366,20 +1652,20 @@ static void defg1(void)
 					_cos = gcur.cos;
 				x = xtmp * _cos - y * _sin;
 				y = xtmp * _sin + y * _cos;
-				fprintf(fout, " translate(%.2f, %.2f)", x, y);
+				svg_printf(" translate(%.2f, %.2f)", x, y);
 				x_rot = gcur.xoffs;
 				y_rot = gcur.yoffs;
 				gcur.xoffs = 0;
 				gcur.yoffs = 0;
 			}
-			fprintf(fout, " rotate(%.2f)", gcur.rotate);
+			svg_printf(" rotate(%.2f)", gcur.rotate);
 		}
 		fputs("\"", fout);
 	}
 	output_font(0);
 //jfm test
-//	fprintf(fout, "%s>\n", gcur.dash);
-	fprintf(fout, ">\n");
+//	svg_printf("%s>\n", gcur.dash);
+	svg_printf(">\n");
 	g = 1;
 	memcpy(&gold, &gcur, sizeof gold);
 }
@@ -1424,23 +1710,26 @@ static void setg(int newg)
 static void path_print(char *fmt, ...)
 {
 	va_list args;
-	char *p;
+	int l;
 
-	va_start(args, fmt);
-	vsnprintf(path_buf, sizeof path_buf, fmt, args);
-	va_end(args);
-	if (!path) {
-		path = malloc(strlen(path_buf) + 1);
-		p = path;
-	} else {
-		path = realloc(path, strlen(path) + strlen(path_buf) + 1);
-		p = path + strlen(path);
-	}
-	if (!path) {
-		fprintf(stderr, "Out of memory.\n");
-		exit(EXIT_FAILURE);
+	for (;;) {
+		va_start(args, fmt);
+		l = vsnprintf(path_buf + path_len, path_sz - path_len,
+				fmt, args);
+		va_end(args);
+		if (path_len + l < path_sz)
+			break;
+		path_sz = path_sz ? path_sz * 2 : 1024;
+		if (path_sz <= path_len + l)
+			path_sz = path_len + l + 1;
+		path_buf = realloc(path_buf, path_sz);
+		if (!path_buf) {
+			fprintf(stderr, "Out of memory.\n");
+			fatal_exit();
+		}
 	}
-	strcpy(p, path_buf);
+	path_len += l;
+	path = path_buf;
 }
 
 static void path_def(void)
@@ -1455,8 +1744,8 @@ static void path_def(void)
 static void path_end(void)
 {
 	setg(1);
-	fputs(path, fout);
-	free(path);
+	fwrite(path_buf, 1, path_len, fout);
+	path_len = 0;
 	path = NULL;
 }
 
@@ -1522,7 +1811,7 @@ static void xysym(char *op, int use)
 		def_use(use);
 	y = gcur.yoffs - pop_free_val();
 	x = gcur.xoffs + pop_free_val();
-	fprintf(fout, "<use x=\"%.2f\" y=\"%.2f\" xlink:href=\"#%s\"/>\n",
+	svg_printf("<use x=\"%.2f\" y=\"%.2f\" xlink:href=\"#%s\"/>\n",
 		x, y, op);
 }
 
@@ -1553,7 +1842,7 @@ static void setxysym(char *op, int use)
 	setxory("x", x);
 	setxory("y", y);
 	def_use(use);
-	fprintf(fout, "<use x=\"%.2f\" y=\"%.2f\" xlink:href=\"#%s\"/>\n",
+	svg_printf("<use x=\"%.2f\" y=\"%.2f\" xlink:href=\"#%s\"/>\n",
 		gcur.xoffs + x, gcur.yoffs - y, op);
 }
 
@@ -1566,9 +1855,9 @@ static void acciac(char *op)
 	setg(1);
 	dy = pop_free_val();
 	dx = pop_free_val();
-	sym = ps_sym_lookup("x");
+	sym = sym_x;
 	x = gcur.xoffs + sym->e->u.v;
-	sym = ps_sym_lookup("y");
+	sym = sym_y;
 	y = gcur.yoffs - sym->e->u.v;
 	if (op[1] == 'u') {
 		x -= 1;
@@ -1577,7 +1866,7 @@ static void acciac(char *op)
 		x -= 5;
 		y += 4;
 	}
-	fprintf(fout,
+	svg_printf(
 		"<path d=\"M%.2f %.2fl%.2f %.2f\" class=\"stroke\"/>\n",
 		x, y, dx, -dy);
 }
@@ -1593,19 +1882,19 @@ static void arp_ltr(char type)
 	x = gcur.xoffs + pop_free_val();
 	n = (pop_free_val() + 5) / 6;
 	if (type == 'a') {
-		fprintf(fout, "<g transform=\"rotate(270)\">\n");
+		svg_printf("<g transform=\"rotate(270)\">\n");
 		t = x;
 		x = -y;
 		y = t;
 	}
 	y -= 4;
 	while (--n >= 0) {
-		fprintf(fout, "<use x=\"%.2f\" y=\"%.2f\" xlink:href=\"#ltr\"/>\n",
+		svg_printf("<use x=\"%.2f\" y=\"%.2f\" xlink:href=\"#ltr\"/>\n",
 			x, y);
 		x += 6;
 	}
 	if (type == 'a')
-		fprintf(fout, "</g>\n");
+		svg_printf("</g>\n");
 }
 
 // glissando
@@ -1623,21 +1912,21 @@ static void gliss(int squiggle)
 	ar = atan((y2 - y1) / (x2 - x1));
 	a = ar / M_PI * 180;
 	len = (x2 - x1 - 14) / cos(ar);
-	fprintf(fout,
+	svg_printf(
 		"<g transform=\"translate(%.2f,%.2f) rotate(%.2f)\">\n",
 		x1, y1, a);
 	if (squiggle) {
 		n = (len + 2) / 6;
 		x1 = 8;
 		while (--n >= 0) {
-			fprintf(fout, "<use x=\"%.2f\" xlink:href=\"#ltr\"/>\n", x1);
+			svg_printf("<use x=\"%.2f\" xlink:href=\"#ltr\"/>\n", x1);
 			x1 += 6;
 		}
 	} else {
-		fprintf(fout, "<path class=\"stroke\" stroke-width=\"1\"\n"
+		svg_printf("<path class=\"stroke\" stroke-width=\"1\"\n"
 			"	d=\"M8 0l%.2f 0\"/>\n", len);
 	}
-	fprintf(fout, "</g>\n");
+	svg_printf("</g>\n");
 }
 
 /* sd su gd gu */
@@ -1656,12 +1945,12 @@ static void stem(char *op)
 		dx = GSTEM_XOFF;
 	if (op[1] == 'd')
 		dx = -dx;
-	sym = ps_sym_lookup("x");
+	sym = sym_x;
 	x = gcur.xoffs + sym->e->u.v + dx;
-	sym = ps_sym_lookup("y");
+	sym = sym_y;
 	y = gcur.yoffs - sym->e->u.v;
 
-	fprintf(fout,
+	svg_printf(
 		"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n",
 		x, y, -h);
 }
@@ -1723,28 +2012,28 @@ static void show(char type)
 		break;
 	}
 	if (span) {
-		fprintf(fout, "<tspan\n\t");
+		svg_printf("<tspan\n\t");
 		output_font(1);
-		fprintf(fout, ">");
+		svg_printf(">");
 	} else if (g != 2) {
-		fprintf(fout, "<text x=\"%.2f\" y=\"%.2f\"",
+		svg_printf("<text x=\"%.2f\" y=\"%.2f\"",
 				gcur.xoffs + x, gcur.yoffs - y);
 		switch (type) {
 		case 'c':
-			fprintf(fout, " text-anchor=\"middle\"");
+			svg_printf(" text-anchor=\"middle\"");
 			w /= 2;
 			break;
 		case 'r':
-			fprintf(fout, " text-anchor=\"end\"");
+			svg_printf(" text-anchor=\"end\"");
 			w = 0;
 			break;
 		case 'j':
-			fprintf(fout, " textLength=\"%.2f\"", w);
+			svg_printf(" textLength=\"%.2f\"", w);
 			break;
 		}
 
 //		if (gcur.rgb != 0)
-//			fprintf(fout, " class=\"fill\"");
+//			svg_printf(" class=\"fill\"");
 		fputs(">", fout);
 		g = 2;
 	}
@@ -1752,7 +2041,7 @@ static void show(char type)
 back:
 	xml_str_out(p);
 	if (span)
-		fprintf(fout, "</tspan>");
+		svg_printf("</tspan>");
 
 	if (type == 'x') {
 		p = p + strlen(p) + 1;		/* next string of gxshow */
@@ -1765,13 +2054,13 @@ back:
 			w = free_elt->u.v;
 			type = 's';
 		}
-		fprintf(fout, "<tspan dx=\"%.2f\">", w);
+		svg_printf("<tspan dx=\"%.2f\">", w);
 		span = 1;
 		goto back;
 	}
 	if (type == 'b') {
 		setg(1);
-		fprintf(fout,
+		svg_printf(
 			"<rect class=\"stroke\" stroke-width=\"0.6\"\n"
 			"	x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"%.2f\"/>\n",
 			gcur.xoffs + gcur.cx - 2, gcur.yoffs - y - gcur.font_s + 2,
@@ -1782,6 +2071,67 @@ back:
 		free(s);
 }
 
+/* moveto / M */
+static void moveto(void)
+{
+	gcur.cy = pop_free_val();
+	gcur.cx = pop_free_val();
+	if (path) {
+		path_print("\tM%.2f %.2f\n",
+			gcur.xoffs + gcur.cx, gcur.yoffs - gcur.cy);
+	} else if (g == 2) {
+		fputs("</text>\n", fout);
+		g = 1;
+	}
+}
+
+/* rmoveto / RM */
+static void rmoveto(void)
+{
+	float x, y;
+
+	y = pop_free_val();
+	x = pop_free_val();
+	if (path) {
+		path_print("\tm%.2f %.2f\n", x, -y);
+	} else if (g == 2) {
+		fputs("</text>\n", fout);
+		g = 1;
+	}
+	gcur.cx += x;
+	gcur.cy += y;
+}
+
+/* rlineto / RL */
+static void rlineto(void)
+{
+	float x, y;
+
+	path_def();
+	y = pop_free_val();
+	x = pop_free_val();
+	if (x == 0)
+		path_print("\tv%.2f\n", -y);
+	else if (y == 0)
+		path_print("\th%.2f\n", x);
+	else
+		path_print("\tl%.2f %.2f\n", x, -y);
+	gcur.cx += x;
+	gcur.cy += y;
+}
+
+static void stroke(void)
+{
+	if (!path) {
+		fprintf(stderr, "svg: 'stroke' with no path\n");
+//		ps_error = 1;
+		return;
+	}
+	path_end();
+	svg_printf("\t\" class=\"stroke\"%s/>\n",
+			gcur.dash);
+}
+
 /* execute a sequence
  * returns 1 on 'exit' or error */
 static int seq_exec(struct elt_s *e)
@@ -1789,11 +2139,14 @@ static int seq_exec(struct elt_s *e)
 	struct elt_s *e2;
 
 	switch (e->type) {
+	case NAME:
+		if (e->u.sym == sym_exit)
+			return 1;
+		ps_sym_exec(e->u.sym);
+		return 0;
 	case STR:
 		if (e->u.s[0] != '/'
 		 && e->u.s[0] != '(') {
-			if (strcmp(e->u.s, "exit") == 0)
-				return 1;
 			ps_exec(e->u.s);
 			return 0;
 		}
@@ -1810,9 +2163,12 @@ static int seq_exec(struct elt_s *e)
 	e = e->u.e;
 	while (e) {
 		switch (e->type) {
-		case STR:
-			if (strcmp(e->u.s, "exit") == 0)
+		case NAME:
+			if (e->u.sym == sym_exit)
 				return 1;
+			ps_sym_exec(e->u.sym);
+			break;
+		case STR:
 			if (e->u.s[0] != '(' && e->u.s[0] != '/') {
 				ps_exec(e->u.s);
 				break;
@@ -1830,101 +2186,904 @@ static int seq_exec(struct elt_s *e)
 	return 0;
 }
 
-/* execute a command */
-/* (in case of error, a string may be not freed, but this is not important!) */
-static void ps_exec(char *op)
+/* execute a compiled procedure
+ * returns 1 on 'exit' or error */
+static int code_exec(struct ps_code *c, int n)
+{
+	struct elt_s *e;
+
+	for ( ; --n >= 0; c++) {
+		switch (c->type) {
+		case VAL:
+			e = elt_new();
+			if (!e)
+				return 1;
+			e->u.v = c->u.v;
+			push(e);
+			break;
+		case NAME:
+			if (c->u.sym == sym_exit)
+				return 1;
+			ps_sym_exec(c->u.sym);
+			break;
+		case STR:
+			if (c->u.e->u.s[0] != '('
+			 && c->u.e->u.s[0] != '/') {
+				ps_exec(c->u.e->u.s);
+				break;
+			}
+			/* fall thru */
+		default:
+			e = elt_dup(c->u.e);
+			if (!e)
+				return 1;
+			push(e);
+			break;
+		}
+	}
+	return 0;
+}
+
+/* execute a drawing operation (see put_op() in draw.c) */
+static void op_draw(int op)
 {
 	struct ps_sym_s *sym;
-	struct elt_s *e, *e2;
 	float x, y, w, h;
 	int n;
-	char *s;
+	char *s, *nm;
 
-	if (ps_error)
+	nm = drawop_nm[op];
+	switch (op) {
+	case OP_hd:
+		setxysym(nm, D_hd);
 		return;
-#if 0
-fprintf(stderr, "%s ", op);
-stack_dump();
-#endif
-	sym = ps_sym_lookup(op);
-	if (sym) {
-		if (++sym->exec > 2) {
-			fprintf(stderr, "svg: Too many recursions of '%s'\n",
-				op);
+	case OP_Hd:
+		setxysym(nm, D_Hd);
+		return;
+	case OP_HD:
+		setxysym(nm, D_HD);
+		return;
+	case OP_HDD:
+		setxysym(nm, D_HDD);
+		return;
+	case OP_breve:
+		setxysym(nm, D_breve);
+		return;
+	case OP_longa:
+		setxysym(nm, D_longa);
+		return;
+	case OP_ghd:
+		setxysym(nm, D_ghd);
+		return;
+	case OP_custos:
+		xysym(nm, D_custos);
+		return;
+	case OP_xydef:
+		y = pop_free_val();
+		x = pop_free_val();
+		setxory("x", x);
+		setxory("y", y);
+		return;
+	case OP_pshhd:
+		setxysym(nm, D_pshhd);
+		return;
+	case OP_pfthd:
+		setxysym(nm, D_pfthd);
+		return;
+	case OP_r00:
+		setxysym(nm, D_r00);
+		return;
+	case OP_r0:
+		setxysym(nm, D_r0);
+		return;
+	case OP_r1:
+		setxysym(nm, D_r1);
+		return;
+	case OP_r2:
+		setxysym(nm, D_r2);
+		return;
+	case OP_r4:
+		setxysym(nm, D_r4);
+		return;
+	case OP_r8:
+		setxysym(nm, D_r8);
+		return;
+	case OP_r16:
+		setxysym(nm, D_r16);
+		return;
+	case OP_r32:
+		setxysym(nm, D_r32);
+		return;
+	case OP_r64:
+		setxysym(nm, D_r64);
+		return;
+	case OP_r128:
+		setxysym(nm, D_r128);
+		return;
+	case OP_mrest:
+#if 1
+		xysym(nm, D_mrest);
+		return;
+#else
+		def_use(D_mrest);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		s = pop_free_str();
+		if (!s) {
+			fprintf(stderr, "svg: No string\n");
 			ps_error = 1;
 			return;
 		}
-		seq_exec(sym->e);
-		sym->exec--;
+		svg_printf("<use x=\"%.2f\" y=\"%.2f\" xlink:href=\"#mrest\"/>\n"
+			"<text style=\"font:bold 15px serif\"\n"
+			"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"middle\">%s</text>\n",
+			x, y, x, y - 28, s + 1);
+		free(s);
+#endif
 		return;
-	}
-
-	if (*op == ' ')				/* load */
-		op++;
+	case OP_mrep:
+		xysym(nm, D_mrep);
+		return;
+	case OP_mrep2:
+		xysym(nm, D_mrep2);
+		return;
+	case OP_srep:
+		xysym(nm, D_srep);
+		return;
+	case OP_showerror:
+		xysym(nm, D_showerror);
+		return;
+	case OP_hl:
+		xysym(nm, D_hl);
+		return;
+	case OP_hl1:
+		xysym(nm, D_hl1);
+		return;
+	case OP_hl2:
+		xysym(nm, D_hl2);
+		return;
+	case OP_ghl:
+		xysym(nm, D_ghl);
+		return;
+	case OP_tclef:
+		xysym(nm, D_tclef);
+		return;
+	case OP_cclef:
+		xysym(nm, D_cclef);
+		return;
+	case OP_bclef:
+		xysym(nm, D_bclef);
+		return;
+	case OP_pclef:
+		xysym(nm, D_pclef);
+		return;
+	case OP_stclef:
+		xysym(nm, D_stclef);
+		return;
+	case OP_scclef:
+		xysym(nm, D_scclef);
+		return;
+	case OP_sbclef:
+		xysym(nm, D_sbclef);
+		return;
+	case OP_spclef:
+		xysym(nm + 1, D_pclef);		// same as 'pclef'
+		return;
+	case OP_oct:
+		setg(1);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		svg_printf("<text style=\"font:12px serif\"\n"
+			"	x=\"%.2f\" y=\"%.2f\">8</text>\n",
+			x, y);
+		return;
+	case OP_sh0:
+		xysym(nm, D_sh0);
+		return;
+	case OP_ft0:
+		xysym(nm, D_ft0);
+		return;
+	case OP_nt0:
+		xysym(nm, D_nt0);
+		return;
+	case OP_csig:
+		xysym(nm, D_csig);
+		return;
+	case OP_ctsig:
+		xysym(nm, D_ctsig);
+		return;
+	case OP_imsig:
+		xysym(nm, D_imsig);
+		return;
+	case OP_iMsig:
+		xysym(nm, D_iMsig);
+		return;
+	case OP_pmsig:
+		xysym(nm, D_pmsig);
+		return;
+	case OP_pMsig:
+		xysym(nm, D_pMsig);
+		return;
+	case OP_tsig: {
+			char *d;
 
-	switch (*op) {
-	case '!':				/* def */
-		if (op[1] == '\0') {
-			if (!stack) {
-				fprintf(stderr, "svg def: Stack empty\n");
-				ps_error = 1;
-				return;
-			}
-			e = pop(stack->type);	/* value */
-			s = pop_free_str();	/* symbol */
-			if (!s || *s != '/') {
-				fprintf(stderr, "svg def: No / bad symbol\n");
+			setg(1);
+			y = gcur.yoffs - pop_free_val() - 0.5;
+			x = gcur.xoffs + pop_free_val();
+			d = pop_free_str();
+			s = pop_free_str();
+			if (!d || !s) {
+				fprintf(stderr, "svg: No string\n");
+				if (d)
+					free(d);
 				if (s)
 					free(s);
 				ps_error = 1;
 				return;
 			}
-			ps_sym_def(&s[1], e);
+			svg_printf("<g style=\"font:bold 16px serif\"\n"
+				"	transform=\"translate(%.2f,%.2f) scale(1.2,1)\">\n"
+				"	<text text-anchor=\"middle\">%s</text>\n"
+				"	<text y=\"-12\" text-anchor=\"middle\">%s</text>\n"
+				"</g>\n",
+				x, y, d + 1, s + 1);
+			free(d);
 			free(s);
 			return;
 		}
-		break;
-	case 'a':
-		if (strcmp(op, "accent") == 0) {
-			xysym(op, D_accent);
-			return;
-		}
-		if (strcmp(op, "abs") == 0) {
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg abs: Bad value\n");
-				ps_error = 1;
-				return;
-			}
-			if (stack->u.v < 0)
-				stack->u.v = -stack->u.v;
+	case OP_stsig:
+		setg(1);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		s = pop_free_str();
+		if (!s) {
+			fprintf(stderr, "svg: No string\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "add") == 0) {
-			x = pop_free_val();
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg add: Bad value\n");
-				ps_error = 1;
-				return;
+		svg_printf("<g style=\"font:bold 18px serif\"\n"
+			"	transform=\"translate(%.2f,%.2f) scale(1.2,1)\">\n"
+			"	<text y=\"-7\" text-anchor=\"middle\">%s</text>\n"
+			"</g>\n",
+			x, y, s + 1);
+		free(s);
+		return;
+	case OP_su:
+	case OP_sd:
+		stem(nm);
+		return;
+	case OP_gu:
+	case OP_gd:
+		stem(nm);
+		return;
+	case OP_sfu:
+		setg(1);
+		h = pop_free_val();
+		n = pop_free_val();
+		sym = sym_x;
+		x = gcur.xoffs + sym->e->u.v + 3.5;
+		sym = sym_y;
+		y = gcur.yoffs - sym->e->u.v;
+		svg_printf(
+			"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
+			"<path class=\"fill\"\n"
+			"	d=\"",
+			x, y, -h);
+		y -= h;
+		if (n == 1) {
+			svg_printf(
+				"M%.2f %.2fc0.6 5.6 9.6 9 5.6 18.4\n"
+				"	1.6 -6 -1.3 -11.6 -5.6 -12.8\n",
+				x, y);
+		} else {
+			while (--n >= 0) {
+				svg_printf(
+					"M%.2f %.2fc0.9 3.7 9.1 6.4 6 12.4\n"
+					"	1 -5.4 -4.2 -8.4 -6 -8.4\n",
+					x, y);
+				y += 5.4;
+			}
+		}
+		svg_printf("\"/>\n");
+		return;
+	case OP_sfd:
+		setg(1);
+		h = pop_free_val();
+		n = pop_free_val();
+		sym = sym_x;
+		x = gcur.xoffs + sym->e->u.v - 3.5;
+		sym = sym_y;
+		y = gcur.yoffs - sym->e->u.v;
+		svg_printf(
+			"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
+			"<path class=\"fill\"\n"
+			"	d=\"",
+			x, y, -h);
+		y -= h;
+		if (n == 1) {
+			svg_printf(
+				"M%.2f %.2fc0.6 -5.6 9.6 -9 5.6 -18.4\n"
+				"	1.6 6 -1.3 11.6 -5.6 12.8\n",
+				x, y);
+		} else {
+			while (--n >= 0) {
+				svg_printf(
+					"M%.2f %.2fc0.9 -3.7 9.1 -6.4 6 -12.4\n"
+					"	1 5.4 -4.2 8.4 -6 8.4\n",
+					x, y);
+				y -= 5.4;
+			}
+		}
+		svg_printf("\"/>\n");
+		return;
+	case OP_sfs:
+		setg(1);
+		h = pop_free_val();
+		n = pop_free_val();
+		sym = sym_x;
+		x = gcur.xoffs + sym->e->u.v;
+		sym = sym_y;
+		y = gcur.yoffs - sym->e->u.v - 1;
+		if (h > 0) {
+			x += 3.5;
+			y -= 1;
+			svg_printf(
+				"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
+				"<path class=\"fill\"\n"
+				"	d=\"",
+				x, y, -h + 1);
+			y -= h - 1;
+			while (--n >= 0) {
+				svg_printf(
+					"M%.2f %.2fl7 3.2 0 3.2 -7 -3.2z\n",
+					x, y);
+				y += 5.4;
+			}
+		} else {
+			x -= 3.5;
+			y += 1;
+			svg_printf(
+				"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
+				"<path class=\"fill\"\n"
+				"	d=\"",
+				x, y, -h - 1);
+			y -= h + 1;
+			while (--n >= 0) {
+				svg_printf(
+					"M%.2f %.2fl7 -3.2 0 -3.2 -7 3.2z\n",
+					x, y);
+				y -= 5.4;
+			}
+		}
+		svg_printf("\"/>\n");
+		return;
+	case OP_sgu:
+		setg(1);
+		h = pop_free_val();
+		n = pop_free_val();
+		sym = sym_x;
+		x = gcur.xoffs + sym->e->u.v + GSTEM_XOFF;
+		sym = sym_y;
+		y = gcur.yoffs - sym->e->u.v;
+		svg_printf(
+			"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
+			"<path class=\"fill\"\n"
+			"	d=\"",
+			x, y, -h);
+		y -= h;
+		if (n == 1) {
+			svg_printf(
+				"M%.2f %.2fc0.6 3.4 5.6 3.8 3 10\n"
+				"	1.2 -4.4 -1.4 -7 -3 -7\n",
+				x, y);
+		} else {
+			while (--n >= 0) {
+				svg_printf(
+					"M%.2f %.2fc1 3.2 5.6 2.8 3.2 8\n"
+					"	1.4 -4.8 -2.4 -5.4 -3.2 -5.2\n",
+				x, y);
+				y += 3.5;
+			}
+		}
+		svg_printf("\"/>\n");
+		return;
+	case OP_sgd:
+		setg(1);
+		h = pop_free_val();
+		n = pop_free_val();
+		sym = sym_x;
+		x = gcur.xoffs + sym->e->u.v - GSTEM_XOFF;
+		sym = sym_y;
+		y = gcur.yoffs - sym->e->u.v;
+		svg_printf(
+			"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
+			"<path class=\"fill\"\n"
+			"	d=\"",
+			x, y, -h);
+		y -= h;
+		if (n == 1) {
+			svg_printf(
+				"M%.2f %.2fc0.6 -3.4 5.6 -3.8 3 -10\n"
+				"	1.2 4.4 -1.4 7 -3 7\n",
+				x, y);
+		} else {
+			while (--n >= 0) {
+				svg_printf(
+					"M%.2f %.2fc1 -3.2 5.6 -2.8 3.2 -8\n"
+					"	1.4 4.8 -2.4 5.4 -3.2 5.2\n",
+					x, y);
+				y -= 3.5;
 			}
-			stack->u.v += x;
+		}
+		svg_printf("\"/>\n");
+		return;
+	case OP_sgs:
+		setg(1);
+		h = pop_free_val();
+		n = pop_free_val();
+		sym = sym_x;
+		x = gcur.xoffs + sym->e->u.v + GSTEM_XOFF;
+		sym = sym_y;
+		y = gcur.yoffs - sym->e->u.v;
+		svg_printf(
+			"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
+			"<path class=\"fill\"\n"
+			"	d=\"",
+			x, y, -h);
+		y -= h;
+		while (--n >= 0) {
+			svg_printf(
+				"M%.2f %.2fl3 1.5 0 2 -3 -1.5z\n",
+				x, y);
+			y += 3;
+		}
+		svg_printf("\"/>\n");
+		return;
+	case OP_gua:
+	case OP_gda:
+		acciac(nm);
+		return;
+	case OP_dt:
+		setg(1);
+		sym = sym_x;
+		x = gcur.xoffs + sym->e->u.v;
+		sym = sym_y;
+		y = gcur.yoffs - sym->e->u.v;
+		y -= pop_free_val();
+		x += pop_free_val();
+		svg_printf(
+			"<circle class=\"fill\" cx=\"%.2f\" cy=\"%.2f\" r=\"1.2\"/>\n",
+			x, y);
+		return;
+	case OP_rdots:
+		xysym(nm, D_rdots);
+		return;
+	case OP_bm: {
+			float dx, dy;
+
+			setg(1);
+			y = gcur.yoffs - pop_free_val();
+			x = gcur.xoffs + pop_free_val();
+			dy = pop_free_val();
+			dx = pop_free_val();
+			h = pop_free_val();
+			svg_printf(
+				"<path class=\"fill\"\n"
+				"	d=\"M%.2f %.2fl%.2f %.2fv%.2fl%.2f %.2f\"/>\n",
+				x, y, dx, -dy, h,-dx, dy);
 			return;
 		}
-		if (strcmp(op, "and") == 0) {
+	case OP_trem:
+		setg(1);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val() - 4.5;
+		n = pop_free_val();
+		svg_printf("<path class=\"fill\" d=\"m%.2f %.2f\n\t",
+			x, y);
+		for (;;) {
+			fputs("l9 -3v3l-9 3z", fout);
+			if (--n <= 0)
+				break;
+			fputs("m0 5.4", fout);
+		}
+		fputs("\"/>", fout);
+		return;
+	case OP_bar:
+		setg(1);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		h = pop_free_val();
+		svg_printf("<path class=\"stroke\" stroke-width=\"1\"\n"
+			"	d=\"M%.2f %.2fv%.2f\"/>\n",
+			x, y, -h);
+		return;
+	case OP_thbar:
+		setg(1);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val() + 1.5;
+		h = pop_free_val();
+		svg_printf(
+			"<path class=\"stroke\" stroke-width=\"3\"\n"
+			"	d=\"M%.2f %.2fv%.2f\"/>\n",
+			x, y, -h);
+		return;
+	case OP_dotbar:
+		setg(1);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		h = pop_free_val();
+		svg_printf(
+			"<path class=\"stroke\" stroke-dasharray=\"5,5\"\n"
+			"	d=\"M%.2f %.2fv%.2f\"/>\n",
+			x, y, -h);
+		return;
+	case OP_brace:
+		def_use(D_brace);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		h = pop_free_val() * 0.01;
+		svg_printf(
+			"<g transform=\"translate(%.2f,%.2f) scale(1,%.2f)\">\n"
+			"	<use xlink:href=\"#brace\"/>\n"
+			"</g>\n",
+			x, y, h);
+		return;
+	case OP_bracket:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 3;
+		x = gcur.xoffs + pop_free_val() - 5;
+		h = pop_free_val() + 2;
+		svg_printf(
+			"<path class=\"fill\"\n"
+			"	d=\"M%.2f %.2f\n"
+			"	c10.5 1 12 -4.5 12 -3.5c0 1 -3.5 5.5 -8.5 5.5\n"
+			"	v%.2f\n"
+			"	c5 0 8.5 4.5 8.5 5.5c0 1 -1.5 -4.5 -12 -3.5\"/>\n",
+			x, y, h);
+		return;
+	case OP_wln:
+		setg(1);
+		y = pop_free_val();
+		x = pop_free_val();
+		w = pop_free_val();
+		svg_printf("<path class=\"stroke\" stroke-width=\"0.8\"\n"
+			"	d=\"M%.2f %.2fh%.2f\"/>\n",
+			gcur.xoffs + x, gcur.yoffs - y, w);
+		return;
+	case OP_hyph: {
+			int d;
+
+			setg(1);
+			y = pop_free_val();
 			x = pop_free_val();
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg and: Bad value\n");
-				ps_error = 1;
-				return;
-			}
-			stack->u.v = (int) x & (int) stack->u.v;
+			w = pop_free_val();
+			d = 25 + (int) w / 20 * 3;
+			n = (w - 15.) / d;
+			x += (w - d * n - 5) / 2;
+			svg_printf("<path class=\"stroke\" stroke-width=\"1.2\"\n"
+				"	stroke-dasharray=\"5,%d\"\n"
+				"	d=\"M%.2f %.2fh%d\"/>\n",
+				d - 5,
+				gcur.xoffs + x, gcur.yoffs - y - gcur.font_s * 0.3,
+				d * n + 5);
+			return;
+		}
+	case OP_accent:
+		xysym(nm, D_accent);
+		return;
+	case OP_arp:
+		arp_ltr('a');
+		return;
+	case OP_brth:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 6;
+		x = gcur.xoffs + pop_free_val();
+		svg_printf("<text x=\"%.2f\" y=\"%.2f\""
+				" style=\"font:bold italic 30px serif\">"
+				",</text>\n",
+			x, y);
+		return;
+	case OP_coda:
+		xysym(nm, D_coda);
+		return;
+	case OP_cpu:
+		xysym(nm, D_cpu);
+		return;
+	case OP_cresc:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 5;
+		x = gcur.xoffs + pop_free_val();
+		w = pop_free_val();
+		sym = ps_sym_lookup("defl");
+		x += w;
+		if ((int) sym->e->u.v & 1)
+			svg_printf("<path class=\"stroke\"\n"
+				"d=\"M%.2f %.2fl%.2f -2.2m0 -3.6l%.2f -2.2\"/>\n",
+				x, y, -w, w);
+		else
+			svg_printf("<path class=\"stroke\"\n"
+				"d=\"M%.2f %.2fl%.2f -4l%.2f -4\"/>\n",
+				x, y, -w, w);
+		return;
+	case OP_dim:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 5;
+		x = gcur.xoffs + pop_free_val();
+		w = pop_free_val();
+		sym = ps_sym_lookup("defl");
+		if ((int) sym->e->u.v & 2)
+			svg_printf("<path class=\"stroke\"\n"
+				"d=\"M%.2f %.2fl%.2f -2.2m0 -3.6l%.2f -2.2\"/>\n",
+				x, y, w, -w);
+		else
+			svg_printf("<path class=\"stroke\"\n"
+				"d=\"M%.2f %.2fl%.2f -4l%.2f -4\"/>\n",
+				x, y, w, -w);
+		return;
+	case OP_dnb:
+		xysym(nm, D_dnb);
+		return;
+	case OP_dplus:
+		xysym(nm, D_dplus);
+		return;
+	case OP_emb:
+		xysym(nm, D_emb);
+		return;
+	case OP_glisq:
+	case OP_gliss:
+		gliss(op == OP_glisq);
+		return;
+	case OP_grm:
+		xysym(nm, D_grm);
+		return;
+	case OP_hld:
+		xysym(nm, D_hld);
+		return;
+	case OP_lmrd:
+		xysym(nm, D_lmrd);
+		return;
+	case OP_lphr:
+		xysym(nm, D_lphr);
+		return;
+	case OP_ltr:
+		arp_ltr('l');
+		return;
+	case OP_marcato:
+		xysym(nm, D_marcato);
+		return;
+	case OP_mphr:
+		xysym(nm, D_mphr);
+		return;
+	case OP_o8va:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 5;
+		x = gcur.xoffs + pop_free_val();
+		w = pop_free_val();
+		sym = ps_sym_lookup("defl");
+		if (!((int) sym->e->u.v & 1)) {
+			svg_printf(
+				"<text x=\"%.2f\" y=\"%.2f\""
+				" style=\"font:italic bold 12px serif\">8"
+				"<tspan dy=\"-4\""
+				" style=\"font-size:10px\">va</tspan></text>\n",
+				x - 5, y);
+			x += 14;
+			w -= 14;
+		} else {
+			w -= 5;
+		}
+		y -= 6;
+		svg_printf(
+			"<path class=\"stroke\" stroke-dasharray=\"6,6\""
+			" d=\"M%.2f %.2fh%.2f\"/>\n",
+			x, y, w);
+		if (!((int) sym->e->u.v & 2))
+			svg_printf("<path class=\"stroke\""
+				" d=\"m%.2f %.2fv6\"/>\n",
+				x + w, y);
+
+		return;
+	case OP_o8vb:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 5;
+		x = gcur.xoffs + pop_free_val();
+		w = pop_free_val();
+		sym = ps_sym_lookup("defl");
+		if (!((int) sym->e->u.v & 1)) {
+			svg_printf(
+				"<text x=\"%.2f\" y=\"%.2f\""
+				" style=\"font:italic bold 12px serif\">8"
+				"<tspan dy=\"-4\""
+				" style=\"font-size:10px\">vb</tspan></text>\n",
+				x - 5, y);
+			x += 8;
+			w -= 8;
+		} else {
+			w -= 5;
+		}
+		svg_printf(
+			"<path class=\"stroke\" stroke-dasharray=\"6,6\""
+			" d=\"M%.2f %.2fh%.2f\"/>\n",
+			x, y, w);
+		if (!((int) sym->e->u.v & 2))
+			svg_printf("<path class=\"stroke\""
+				" d=\"m%.2f %.2fv-6\"/>\n",
+				x + w, y);
+
+		return;
+	case OP_opend:
+		xysym(nm, D_opend);
+		return;
+	case OP_ped:
+		xysym(nm, D_ped);
+		return;
+	case OP_pedoff:
+		xysym(nm, D_pedoff);
+		return;
+	case OP_sgno:
+		xysym(nm, D_sgno);
+		return;
+	case OP_sld:
+		xysym(nm, D_sld);
+		return;
+	case OP_snap:
+		xysym(nm, D_snap);
+		return;
+	case OP_sphr:
+		xysym(nm, D_sphr);
+		return;
+	case OP_stc:
+		xysym(nm, D_stc);
+		return;
+	case OP_thumb:
+		xysym(nm, D_thumb);
+		return;
+	case OP_trl:
+		xysym(nm, D_trl);
+		return;
+	case OP_turn:
+		xysym(nm, D_turn);
+		return;
+	case OP_turnx:
+		xysym(nm, D_turnx);
+		return;
+	case OP_umrd:
+		xysym(nm, D_umrd);
+		return;
+	case OP_upb:
+		xysym(nm, D_upb);
+		return;
+	case OP_wedge:
+		xysym(nm, D_wedge);
+		return;
+	case OP_M:
+		moveto();
+		return;
+	case OP_RM:
+		rmoveto();
+		return;
+	case OP_RL:
+		rlineto();
+		return;
+	case OP_stroke:
+		stroke();
+		return;
+	case OP_SLW:
+		gcur.linewidth = pop_free_val();
+		return;
+	case OP_show:
+		show('s');
+		return;
+	case OP_showc:
+		show('c');
+		return;
+	case OP_showr:
+		show('r');
+		return;
+	}
+}
+
+/* convert a decimal number
+ * return 0 if no number */
+static int ps_atof(char *p, float *v)
+{
+	char *q;
+	double d, f;
+	int nd;
+
+	q = p;
+	if (*p == '-' || *p == '+')
+		p++;
+	d = 0;
+	nd = 0;				/* number of digits */
+	while (isdigit((unsigned char) *p)) {
+		d = d * 10 + *p++ - '0';
+		nd++;
+	}
+	if (*p == '.') {
+		p++;
+		f = 1;
+		while (isdigit((unsigned char) *p)) {
+			d = d * 10 + *p++ - '0';
+			f *= 10;
+			nd++;
+		}
+		d /= f;
+	}
+	if (nd == 0)
+		return 0;
+	if (*p == 'e' || *p == 'E' || nd > 15) { /* not exact: use the libc */
+		*v = strtof(q, NULL);
+		return 1;
+	}
+	*v = *q == '-' ? -d : d;
+	return 1;
+}
+
+/* execute a built-in operator */
+/* (in case of error, a string may be not freed, but this is not important!) */
+static void ps_builtin(struct ps_sym_s *ps)
+{
+	struct ps_sym_s *sym;
+	struct elt_s *e, *e2;
+	float x, y, w, h;
+	int n;
+	char *op, *s;
+
+	op = ps->n;
+	switch (ps->op) {
+	case PS_bang:				/* def */
+	case PS_def:
+	case PS_bdef:
+		if (!stack) {
+			fprintf(stderr, "svg def: Stack empty\n");
+			ps_error = 1;
+			return;
+		}
+		e = pop(stack->type);	/* value */
+		s = pop_free_str();	/* symbol */
+		if (!s || *s != '/') {
+			fprintf(stderr, "svg def: No / bad symbol\n");
+			if (s)
+				free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "anshow") == 0) {
-			show('s');
+		ps_sym_def(&s[1], e);
+		free(s);
+		return;
+	case PS_abs:
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg abs: Bad value\n");
+			ps_error = 1;
+			return;
+		}
+		if (stack->u.v < 0)
+			stack->u.v = -stack->u.v;
+		return;
+	case PS_add:
+		x = pop_free_val();
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg add: Bad value\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "arc") == 0
-		 || strcmp(op, "arcn") == 0) {
+		stack->u.v += x;
+		return;
+	case PS_and:
+		x = pop_free_val();
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg and: Bad value\n");
+			ps_error = 1;
+			return;
+		}
+		stack->u.v = (int) x & (int) stack->u.v;
+		return;
+	case PS_anshow:
+		show('s');
+		return;
+	case PS_arc:
+	case PS_arcn: {
 			float r, a1, a2, x1, y1, x2, y2;
 
 			a2 = pop_free_val();
@@ -1979,45 +3138,19 @@ stack_dump();
 			}
 			return;
 		}
-		if (strcmp(op, "arp") == 0) {
-			arp_ltr('a');
-			return;
-		}
-		if (strcmp(op, "atan") == 0) {
-			x = pop_free_val();	/* den */
-			if (!stack || stack->type != VAL || x == 0) {
-				fprintf(stderr, "svg atan: Bad value\n");
-				ps_error = 1;
-				return;
-			}
-			y = stack->u.v;		/* num */
-			stack->u.v = atan(y / x) / M_PI * 180;
-			return;
-		}
-		break;
-	case 'b':
-		if (strcmp(op, "bar") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			h = pop_free_val();
-			fprintf(fout, "<path class=\"stroke\" stroke-width=\"1\"\n"
-				"	d=\"M%.2f %.2fv%.2f\"/>\n",
-				x, y, -h);
-			return;
-		}
-		if (strcmp(op, "bclef") == 0) {
-			xysym(op, D_bclef);
-			return;
-		}
-		if (strcmp(op, "bdef") == 0) {
-			ps_exec("!");
-			return;
-		}
-		if (strcmp(op, "bind") == 0) {
+	case PS_atan:
+		x = pop_free_val();	/* den */
+		if (!stack || stack->type != VAL || x == 0) {
+			fprintf(stderr, "svg atan: Bad value\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "bitshift") == 0) {
+		y = stack->u.v;		/* num */
+		stack->u.v = atan(y / x) / M_PI * 180;
+		return;
+	case PS_bind:
+		return;
+	case PS_bitshift: {
 			int shift;
 
 			shift = pop_free_val();
@@ -2034,123 +3167,61 @@ stack_dump();
 			stack->u.v = n;
 			return;
 		}
-		if (strcmp(op, "bm") == 0) {
-			float dx, dy;
-
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			dy = pop_free_val();
-			dx = pop_free_val();
-			h = pop_free_val();
-			fprintf(fout,
-				"<path class=\"fill\"\n"
-				"	d=\"M%.2f %.2fl%.2f %.2fv%.2fl%.2f %.2f\"/>\n",
-				x, y, dx, -dy, h,-dx, dy);
+	case PS_bnum:
+	case PS_bnumb:
+		setg(1);
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		s = pop_free_str();
+		if (!s) {
+			fprintf(stderr, "svg: No string\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "bnum") == 0
-		 || strcmp(op, "bnumb") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			s = pop_free_str();
-			if (!s) {
-				fprintf(stderr, "svg: No string\n");
-				ps_error = 1;
-				return;
-			}
-			if (op[4] == 'b') {
-				w = 7 * strlen(s);
-				fprintf(fout,
-					"<rect x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"12\" fill=\"white\"/>\n",
-					x - w / 2, y - 10, w);
-			}
-			fprintf(fout,
-				"<text style=\"font:italic 12px serif\"\n"
-				"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"middle\">%s</text>\n",
-				x, y, s + 1);
-			free(s);
-			return;
+		if (op[4] == 'b') {
+			w = 7 * strlen(s);
+			svg_printf(
+				"<rect x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"12\" fill=\"white\"/>\n",
+				x - w / 2, y - 10, w);
 		}
-		if (strcmp(op, "box") == 0) {
-			setg(1);
-			h = pop_free_val();
-			w = pop_free_val();
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			fprintf(fout,
-				"<rect class=\"stroke\"\n"
-				"	x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"%.2f\"/>\n",
-				x, y - h, w, h);
-			return;
-		}
-		if (strcmp(op, "boxdraw") == 0) {
-			setg(1);
-			h = pop_free_val();
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			fprintf(fout,
-				"<rect class=\"stroke\"\n"
-				"	x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"%.2f\"/>\n",
-				x, y - h, boxend - (x - gcur.xoffs) + 2, h);
-			return;
-		}
-		if (strcmp(op, "boxmark") == 0) {
-			if (gcur.cx > boxend)
-				boxend = gcur.cx;
-			return;
-		}
-		if (strcmp(op, "boxend") == 0) {
+		svg_printf(
+			"<text style=\"font:italic 12px serif\"\n"
+			"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"middle\">%s</text>\n",
+			x, y, s + 1);
+		free(s);
+		return;
+	case PS_box:
+		setg(1);
+		h = pop_free_val();
+		w = pop_free_val();
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		svg_printf(
+			"<rect class=\"stroke\"\n"
+			"	x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"%.2f\"/>\n",
+			x, y - h, w, h);
+		return;
+	case PS_boxdraw:
+		setg(1);
+		h = pop_free_val();
+		y = gcur.yoffs - pop_free_val();
+		x = gcur.xoffs + pop_free_val();
+		svg_printf(
+			"<rect class=\"stroke\"\n"
+			"	x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"%.2f\"/>\n",
+			x, y - h, boxend - (x - gcur.xoffs) + 2, h);
+		return;
+	case PS_boxmark:
+		if (gcur.cx > boxend)
 			boxend = gcur.cx;
-			return;
-		}
-		if (strcmp(op, "brace") == 0) {
-			def_use(D_brace);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			h = pop_free_val() * 0.01;
-			fprintf(fout,
-				"<g transform=\"translate(%.2f,%.2f) scale(1,%.2f)\">\n"
-				"	<use xlink:href=\"#brace\"/>\n"
-				"</g>\n",
-				x, y, h);
-			return;
-		}
-		if (strcmp(op, "bracket") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 3;
-			x = gcur.xoffs + pop_free_val() - 5;
-			h = pop_free_val() + 2;
-			fprintf(fout,
-				"<path class=\"fill\"\n"
-				"	d=\"M%.2f %.2f\n"
-				"	c10.5 1 12 -4.5 12 -3.5c0 1 -3.5 5.5 -8.5 5.5\n"
-				"	v%.2f\n"
-				"	c5 0 8.5 4.5 8.5 5.5c0 1 -1.5 -4.5 -12 -3.5\"/>\n",
-				x, y, h);
-			return;
-		}
-		if (strcmp(op, "breve") == 0) {
-			setxysym(op, D_breve);
-			return;
-		}
-		if (strcmp(op, "brth") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 6;
-			x = gcur.xoffs + pop_free_val();
-			fprintf(fout, "<text x=\"%.2f\" y=\"%.2f\""
-					" style=\"font:bold italic 30px serif\">"
-					",</text>\n",
-				x, y);
-			return;
-		}
-		break;
-	case 'C':
-		if (strcmp(op, "C") == 0) {
+		return;
+	case PS_boxend:
+		boxend = gcur.cx;
+		return;
+	case PS_C:
+	case PS_curveto: {
 			float c1, c2, c3, c4;
 
-curveto:
 			path_def();
 			y = pop_free_val();
 			x = pop_free_val();
@@ -2164,37 +3235,17 @@ curveto:
 			gcur.cy = y;
 			return;
 		}
-		break;
-	case 'c':
-		if (strcmp(op, "cclef") == 0) {
-			xysym(op, D_cclef);
-			return;
-		}
-		if (strcmp(op, "csig") == 0) {
-			xysym(op, D_csig);
-			return;
-		}
-		if (strcmp(op, "ctsig") == 0) {
-			xysym(op, D_ctsig);
-			return;
-		}
-		if (strcmp(op, "coda") == 0) {
-			xysym(op, D_coda);
-			return;
-		}
-		if (strcmp(op, "closepath") == 0) {
-			if (path) {
+	case PS_closepath:
+		if (path) {
 //				path_def();
-				path_print("\tz");
-			}
-			return;
-		}
-		if (strcmp(op, "composefont") == 0) {
-			pop(BRK);
-			pop(STR);
-			return;
+			path_print("\tz");
 		}
-		if (strcmp(op, "copy") == 0) {
+		return;
+	case PS_composefont:
+		pop(BRK);
+		pop(STR);
+		return;
+	case PS_copy: {
 			struct elt_s *e3;
 
 			n = pop_free_val();
@@ -2227,179 +3278,113 @@ curveto:
 			}
 			return;
 		}
-		if (strcmp(op, "cos") == 0) {
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg cos: Bad value\n");
-				ps_error = 1;
-				return;
-			}
-			stack->u.v = cos(stack->u.v * M_PI / 180);
-			return;
-		}
-		if (strcmp(op, "cpu") == 0) {
-			xysym(op, D_cpu);
-			return;
-		}
-		if (strcmp(op, "crdc") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 5;
-			x = gcur.xoffs + pop_free_val();
-			s = pop_free_str();
-			if (!s) {
-				fprintf(stderr, "svg crdc: No string\n");
-				ps_error = 1;
-				return;
-			}
-			fprintf(fout, "<text style=\"font:italic 16px serif\"\n"
-				"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"left\">%s</text>\n",
-				x, y, s + 1);
-			free(s);
-			return;
-		}
-		if (strcmp(op, "cresc") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 5;
-			x = gcur.xoffs + pop_free_val();
-			w = pop_free_val();
-			sym = ps_sym_lookup("defl");
-			x += w;
-			if ((int) sym->e->u.v & 1)
-				fprintf(fout, "<path class=\"stroke\"\n"
-					"d=\"M%.2f %.2fl%.2f -2.2m0 -3.6l%.2f -2.2\"/>\n",
-					x, y, -w, w);
-			else
-				fprintf(fout, "<path class=\"stroke\"\n"
-					"d=\"M%.2f %.2fl%.2f -4l%.2f -4\"/>\n",
-					x, y, -w, w);
-			return;
-		}
-		if (strcmp(op, "custos") == 0) {
-			xysym(op, D_custos);
-			return;
-		}
-		if (strcmp(op, "currentgray") == 0) {
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = (float) gcur.rgb / 0xffffff;
-			push(e);
-			return;
-		}
-		if (strcmp(op, "currentpoint") == 0) {
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = gcur.cx;
-			push(e);
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = gcur.cy;
-			push(e);
-			return;
-		}
-		if (strcmp(op, "curveto") == 0)
-			goto curveto;
-		if (strcmp(op, "cvi") == 0) {
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg cvi: Bad value\n");
-				ps_error = 1;
-				return;
-			}
-			n = stack->u.v;
-			stack->u.v = n;
+	case PS_cos:
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg cos: Bad value\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "cvx") == 0) {
-			s = pop_free_str();
-			if (!s || ((*s != '/') && (*s != '('))) {
-				fprintf(stderr, "svg cvx: No / bad string\n");
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-			*s = '{';
-			svg_write(s, strlen(s));
-			svg_write("}", 1);
-			free(s);
+		stack->u.v = cos(stack->u.v * M_PI / 180);
+		return;
+	case PS_crdc:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 5;
+		x = gcur.xoffs + pop_free_val();
+		s = pop_free_str();
+		if (!s) {
+			fprintf(stderr, "svg crdc: No string\n");
+			ps_error = 1;
 			return;
 		}
-		break;
-	case 'd':
-		if (strcmp(op, "dacs") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 3;
-			x = gcur.xoffs + pop_free_val();
-			s = pop_free_str();
-			if (!s) {
-				fprintf(stderr, "svg dacs: No string\n");
-				ps_error = 1;
-				return;
-			}
-			fprintf(fout, "<text style=\"font:16px serif\"\n"
-				"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"middle\">%s</text>\n",
-				x, y, s + 1);
-			free(s);
+		svg_printf("<text style=\"font:italic 16px serif\"\n"
+			"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"left\">%s</text>\n",
+			x, y, s + 1);
+		free(s);
+		return;
+	case PS_currentgray:
+		e = elt_new();
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "dacoda") == 0) {
-			setg(1);
-			e = elt_dup(stack);
-			y = gcur.yoffs - pop_free_val() - 7;
-			e2 = elt_dup(stack);
-			e2->u.v += 10;
-			x = gcur.xoffs + pop_free_val() - 10;
-			fprintf(fout, "<text style=\"font:16px serif\"\n"
-				"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"middle\">Da</text>\n",
-				x, y);
-			push(e2);
-			push(e);
-			xysym("coda", D_coda);
+		e->type = VAL;
+		e->u.v = (float) gcur.rgb / 0xffffff;
+		push(e);
+		return;
+	case PS_currentpoint:
+		e = elt_new();
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "def") == 0) {
-			ps_exec("!");
+		e->type = VAL;
+		e->u.v = gcur.cx;
+		push(e);
+		e = elt_new();
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "dim") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 5;
-			x = gcur.xoffs + pop_free_val();
-			w = pop_free_val();
-			sym = ps_sym_lookup("defl");
-			if ((int) sym->e->u.v & 2)
-				fprintf(fout, "<path class=\"stroke\"\n"
-					"d=\"M%.2f %.2fl%.2f -2.2m0 -3.6l%.2f -2.2\"/>\n",
-					x, y, w, -w);
-			else
-				fprintf(fout, "<path class=\"stroke\"\n"
-					"d=\"M%.2f %.2fl%.2f -4l%.2f -4\"/>\n",
-					x, y, w, -w);
+		e->type = VAL;
+		e->u.v = gcur.cy;
+		push(e);
+		return;
+	case PS_cvi:
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg cvi: Bad value\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "div") == 0) {
-			x = pop_free_val();
-			if (!stack || stack->type != VAL || x == 0) {
-				fprintf(stderr, "svg: Bad value for div\n");
-				ps_error = 1;
-				return;
-			}
-			stack->u.v /= x;
+		n = stack->u.v;
+		stack->u.v = n;
+		return;
+	case PS_cvx:
+		s = pop_free_str();
+		if (!s || ((*s != '/') && (*s != '('))) {
+			fprintf(stderr, "svg cvx: No / bad string\n");
+			if (s)
+				free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "dnb") == 0) {
-			xysym(op, D_dnb);
+		*s = '{';
+		svg_write(s, strlen(s));
+		svg_write("}", 1);
+		free(s);
+		return;
+	case PS_dacs:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 3;
+		x = gcur.xoffs + pop_free_val();
+		s = pop_free_str();
+		if (!s) {
+			fprintf(stderr, "svg dacs: No string\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "dplus") == 0) {
-			xysym(op, D_dplus);
+		svg_printf("<text style=\"font:16px serif\"\n"
+			"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"middle\">%s</text>\n",
+			x, y, s + 1);
+		free(s);
+		return;
+	case PS_dacoda:
+		setg(1);
+		e = elt_dup(stack);
+		y = gcur.yoffs - pop_free_val() - 7;
+		e2 = elt_dup(stack);
+		e2->u.v += 10;
+		x = gcur.xoffs + pop_free_val() - 10;
+		svg_printf("<text style=\"font:16px serif\"\n"
+			"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"middle\">Da</text>\n",
+			x, y);
+		push(e2);
+		push(e);
+		xysym("coda", D_coda);
+		return;
+	case PS_div:
+		x = pop_free_val();
+		if (!stack || stack->type != VAL || x == 0) {
+			fprintf(stderr, "svg: Bad value for div\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "dSL") == 0) {
+		stack->u.v /= x;
+		return;
+	case PS_dSL: {
 			float a1, a2, a3, a4, a5, a6, m1, m2;
 
 			setg(1);
@@ -2411,172 +3396,113 @@ curveto:
 			a3 = pop_free_val();
 			a2 = pop_free_val();
 			a1 = pop_free_val();
-			fprintf(fout,
+			svg_printf(
 				"<path class=\"stroke\" stroke-dasharray=\"5,5\"\n"
 				"	d=\"M%.2f %.2fc%.2f %.2f %.2f %.2f %.2f %.2f\"/>\n",
 					m1, m2, a1, -a2, a3, -a4, a5, -a6);
 			return;
 		}
-		if (strcmp(op, "dt") == 0) {
-			setg(1);
-			sym = ps_sym_lookup("x");
-			x = gcur.xoffs + sym->e->u.v;
-			sym = ps_sym_lookup("y");
-			y = gcur.yoffs - sym->e->u.v;
-			y -= pop_free_val();
-			x += pop_free_val();
-			fprintf(fout,
-				"<circle class=\"fill\" cx=\"%.2f\" cy=\"%.2f\" r=\"1.2\"/>\n",
-				x, y);
+	case PS_dup:
+		if (!stack) {
+			fprintf(stderr, "svg dup: Stack empty\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "dotbar") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			h = pop_free_val();
-			fprintf(fout,
-				"<path class=\"stroke\" stroke-dasharray=\"5,5\"\n"
-				"	d=\"M%.2f %.2fv%.2f\"/>\n",
-				x, y, -h);
+		e = elt_dup(stack);
+		if (e)
+			push(e);
+		return;
+	case PS_dft0:
+		xysym(op, D_dft0);
+		return;
+	case PS_dsh0:
+		xysym(op, D_dsh0);
+		return;
+	case PS_eofill:
+		if (!path) {
+			fprintf(stderr, "svg eofill: No path\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "dup") == 0) {
-			if (!stack) {
-				fprintf(stderr, "svg dup: Stack empty\n");
-				ps_error = 1;
-				return;
-			}
-			e = elt_dup(stack);
-			if (e)
-				push(e);
+		path_end();
+		svg_printf("\t\" fill-rule=\"evenodd\" class=\"fill\"/>\n");
+		return;
+	case PS_eq:
+		cond(C_EQ);
+		return;
+	case PS_exch:
+		if (!stack || !stack->next) {
+			fprintf(stderr, "svg exch: Stack empty\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "dft0") == 0) {
-			xysym(op, D_dft0);
+		e = stack->next;
+		stack->next = e->next;
+		e->next = stack;
+		stack = e;
+		return;
+	case PS_exec:
+		e = pop(SEQ);
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "dsh0") == 0) {
-			xysym(op, D_dsh0);
+		seq_exec(e);
+		elt_free(e);
+		return;
+	case PS_false:
+		e = elt_new();
+		if (!e)
 			return;
-		}
-		break;
-	case 'e':
-		if (strcmp(op, "emb") == 0) {
-			xysym(op, D_emb);
+		e->type = VAL;
+		e->u.v = 0;
+		push(e);
+		return;
+	case PS_fill:
+		if (!path) {
+			fprintf(stderr, "svg fill: No path\n");
+//				ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "eofill") == 0) {
-			if (!path) {
-				fprintf(stderr, "svg eofill: No path\n");
-				ps_error = 1;
-				return;
-			}
-			path_end();
-			fprintf(fout, "\t\" fill-rule=\"evenodd\" class=\"fill\"/>\n");
+		path_end();
+		svg_printf("\t\" class=\"fill\"/>\n");
+		return;
+	case PS_findfont:
+		s = pop_free_str();
+		if (!s
+		 || *s != '/') {
+			fprintf(stderr, "svg findfont: No / bad font\n");
+			if (s)
+				free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "eq") == 0) {
-			cond(C_EQ);
-			return;
+		if (strcmp(s, gcur.font_n) != 0) {
+			free(gcur.font_n_old);
+			gcur.font_n_old = gcur.font_n;
+			gcur.font_n = s;
+			gold.font_n = NULL;
+		} else {
+			free(s);
 		}
-		if (strcmp(op, "exch") == 0) {
-			if (!stack || !stack->next) {
-				fprintf(stderr, "svg exch: Stack empty\n");
-				ps_error = 1;
-				return;
-			}
-			e = stack->next;
-			stack->next = e->next;
-			e->next = stack;
-			stack = e;
+		return;
+	case PS_fng:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 1;
+		x = gcur.xoffs + pop_free_val() - 3;
+		s = pop_free_str();
+		if (!s) {
+			fprintf(stderr, "svg fng: No string\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "exec") == 0) {
-			e = pop(SEQ);
-			if (!e)
-				return;
-			seq_exec(e);
-			elt_free(e);
-			return;
-		}
-		break;
-	case 'F':
-		if (sscanf(op, "F%d", &n) == 1) {
-			h = pop_free_val();
-			if (!fontnames[n])
-				break;
-			if (gcur.font_s != h
-			 || strcmp(fontnames[n], gcur.font_n) != 0) {
-				free(gcur.font_n_old);
-				gcur.font_n_old = gcur.font_n;
-				gcur.font_n = strdup(fontnames[n]);
-				gcur.font_s = h;
-				gold.font_n = NULL;
-			}
-			return;
-		}
-		break;
-	case 'f':
-		if (strcmp(op, "false") == 0) {
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = 0;
-			push(e);
-			return;
-		}
-		if (strcmp(op, "fill") == 0) {
-			if (!path) {
-				fprintf(stderr, "svg fill: No path\n");
-//				ps_error = 1;
-				return;
-			}
-			path_end();
-			fprintf(fout, "\t\" class=\"fill\"/>\n");
-			return;
-		}
-		if (strcmp(op, "findfont") == 0) {
-			s = pop_free_str();
-			if (!s
-			 || *s != '/') {
-				fprintf(stderr, "svg findfont: No / bad font\n");
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-			if (strcmp(s, gcur.font_n) != 0) {
-				free(gcur.font_n_old);
-				gcur.font_n_old = gcur.font_n;
-				gcur.font_n = s;
-				gold.font_n = NULL;
-			} else {
-				free(s);
-			}
-			return;
-		}
-		if (strcmp(op, "fng") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 1;
-			x = gcur.xoffs + pop_free_val() - 3;
-			s = pop_free_str();
-			if (!s) {
-				fprintf(stderr, "svg fng: No string\n");
-				ps_error = 1;
-				return;
-			}
-			fprintf(fout, "<text style=\"font:8px Bookman\"\n"
-				"	x=\"%.2f\" y=\"%.2f\">%s</text>\n",
-				x, y, s + 1);
-			free(s);
-			return;
-		}
-		if (strcmp(op, "for") == 0) {
-			float init, incr, limit;
-
-			e = pop(SEQ);			/* proc */
+		svg_printf("<text style=\"font:8px Bookman\"\n"
+			"	x=\"%.2f\" y=\"%.2f\">%s</text>\n",
+			x, y, s + 1);
+		free(s);
+		return;
+	case PS_for: {
+			float init, incr, limit;
+
+			e = pop(SEQ);			/* proc */
 			if (!e)
 				return;
 			limit = pop_free_val();
@@ -2616,7 +3542,7 @@ curveto:
 			elt_free(e);
 			return;
 		}
-		if (strcmp(op, "forall") == 0) {
+	case PS_forall: {
 			struct elt_s *e3;
 			unsigned char *p;
 
@@ -2662,103 +3588,91 @@ curveto:
 			elt_free(e2);
 			return;
 		}
-		if (strcmp(op, "ft0") == 0) {
-			xysym(op, D_ft0);
-			return;
-		}
-		if (strcmp(op, "ft1") == 0) {
-			xysym(op, D_ft1);
-			return;
-		}
-		if (strcmp(op, "ft4") == 0) {
-			n = pop_free_val();
-			switch (n) {
-			case 1:
-				xysym("ft1", D_ft1);
-				break;
-			case 2:
-				xysym("ft0", D_ft0);
-				break;
-			case 3:
-				xysym("ft513", D_ft513);
-				break;
-			default:
-				xysym("dft0", D_dft0);
-				break;
-			}
-			return;
-		}
-		if (strcmp(op, "ft513") == 0) {
-			xysym(op, D_ft513);
-			return;
-		}
-		break;
-	case 'g':
-		if (strcmp(op, "gcshow") == 0) {
-			show('s');
-			return;
+	case PS_ft1:
+		xysym(op, D_ft1);
+		return;
+	case PS_ft4:
+		n = pop_free_val();
+		switch (n) {
+		case 1:
+			xysym("ft1", D_ft1);
+			break;
+		case 2:
+			xysym("ft0", D_ft0);
+			break;
+		case 3:
+			xysym("ft513", D_ft513);
+			break;
+		default:
+			xysym("dft0", D_dft0);
+			break;
 		}
-		if (strcmp(op, "ge") == 0) {
-			cond(C_GE);
+		return;
+	case PS_ft513:
+		xysym(op, D_ft513);
+		return;
+	case PS_gcshow:
+		show('s');
+		return;
+	case PS_ge:
+		cond(C_GE);
+		return;
+	case PS_get:
+		n = pop_free_val();
+		if (!stack) {
+			fprintf(stderr, "svg get: Stack empty\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "get") == 0) {
-			n = pop_free_val();
-			if (!stack) {
-				fprintf(stderr, "svg get: Stack empty\n");
+		switch (stack->type) {
+		case VAL:
+			if (n != 0) {
+				fprintf(stderr, "svg get: Out of bounds\n");
 				ps_error = 1;
 				return;
 			}
-			switch (stack->type) {
-			case VAL:
-				if (n != 0) {
-					fprintf(stderr, "svg get: Out of bounds\n");
-					ps_error = 1;
-					return;
-				}
-				return;
-			case STR:
-				s = stack->u.s;
-				if (!s || *s != '(') {
-					fprintf(stderr, "svg get: Not a string\n");
-					if (s)
-						free(s);
-					ps_error = 1;
-					return;
-				}
-				if ((unsigned) n >= strlen(s) - 1) {
-					fprintf(stderr, "svg get: Out of bounds\n");
-					ps_error = 1;
-					return;
-				}
-				stack->type = VAL;
-				stack->u.v = s[n + 1];
-				free(s);
+			return;
+		case STR:
+			s = stack->u.s;
+			if (!s || *s != '(') {
+				fprintf(stderr, "svg get: Not a string\n");
+				if (s)
+					free(s);
+				ps_error = 1;
 				return;
 			}
-			e = stack->u.e;
-			e2 = NULL;
-			while (--n >= 0) {
-				if (!e)
-					break;
-				e2 = e;
-				e = e->next;
-			}
-			if (!e) {
+			if ((unsigned) n >= strlen(s) - 1) {
 				fprintf(stderr, "svg get: Out of bounds\n");
 				ps_error = 1;
 				return;
 			}
-			if (!e2)
-				stack->u.e = e->next;
-			else
-				e2->next = e->next;
-			e->next = stack->next;
-			elt_free(stack);
-			stack = e;
+			stack->type = VAL;
+			stack->u.v = s[n + 1];
+			free(s);
+			return;
+		}
+		e = stack->u.e;
+		e2 = NULL;
+		while (--n >= 0) {
+			if (!e)
+				break;
+			e2 = e;
+			e = e->next;
+		}
+		if (!e) {
+			fprintf(stderr, "svg get: Out of bounds\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "getinterval") == 0) {
+		if (!e2)
+			stack->u.e = e->next;
+		else
+			e2->next = e->next;
+		e->next = stack->next;
+		elt_free(stack);
+		stack = e;
+		return;
+	case PS_getinterval: {
 			int count;
 
 			count = pop_free_val();
@@ -2789,62 +3703,32 @@ curveto:
 			free(s);
 			return;
 		}
-		if (strcmp(op, "ghd") == 0) {
-			setxysym(op, D_ghd);
-			return;
-		}
-		if (strcmp(op, "ghl") == 0) {
-			xysym(op, D_ghl);
-			return;
-		}
-		if (strcmp(op, "glisq") == 0
-		 || strcmp(op, "gliss") == 0) {
-			gliss(op[4] == 'q');
-			return;
-		}
-		if (strcmp(op, "gt") == 0) {
-			cond(C_GT);
-			return;
-		}
-		if (strcmp(op, "gu") == 0
-		 || strcmp(op, "gd") == 0) {
-			stem(op);
-			return;
-		}
-		if (strcmp(op, "gua") == 0
-		 || strcmp(op, "gda") == 0) {
-			acciac(op);
-			return;
-		}
-		if (strcmp(op, "grestore") == 0) {
-			if (nsave <= 0) {
-				fprintf(stderr, "svg grestore: No gsave\n");
-				ps_error = 1;
-				return;
-			}
-			setg(1);
-			free(gcur.font_n);
-			free(gcur.font_n_old);
-			memcpy(&gcur, &gsave[--nsave], sizeof gcur);
+	case PS_gt:
+		cond(C_GT);
+		return;
+	case PS_grestore:
+		if (nsave <= 0) {
+			fprintf(stderr, "svg grestore: No gsave\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "grm") == 0) {
-			xysym(op, D_grm);
+		setg(1);
+		free(gcur.font_n);
+		free(gcur.font_n_old);
+		memcpy(&gcur, &gsave[--nsave], sizeof gcur);
+		return;
+	case PS_gsave:
+		if (nsave >= (int) (sizeof gsave / sizeof gsave[0])) {
+			fprintf(stderr, "svg grestore: Too many gsave's\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "gsave") == 0) {
-			if (nsave >= (int) (sizeof gsave / sizeof gsave[0])) {
-				fprintf(stderr, "svg grestore: Too many gsave's\n");
-				ps_error = 1;
-				return;
-			}
 //			setg(1);
-			memcpy(&gsave[nsave++], &gcur, sizeof gsave[0]);
-			gcur.font_n = strdup(gcur.font_n);
-			gcur.font_n_old = strdup(gcur.font_n_old);
-			return;
-		}
-		if (strcmp(op, "gsl") == 0) {
+		memcpy(&gsave[nsave++], &gcur, sizeof gsave[0]);
+		gcur.font_n = strdup(gcur.font_n);
+		gcur.font_n_old = strdup(gcur.font_n_old);
+		return;
+	case PS_gsl: {
 			float a1, a2, a3, a4, a5, a6, m1, m2;
 
 			setg(1);
@@ -2856,486 +3740,213 @@ curveto:
 			a3 = pop_free_val();
 			a2 = pop_free_val();
 			a1 = pop_free_val();
-			fprintf(fout,
+			svg_printf(
 				"<path class=\"stroke\"\n"
 				"	d=\"M%.2f %.2fc%.2f %.2f %.2f %.2f %.2f %.2f\"/>\n",
 					m1, m2, a1, -a2, a3, -a4, a5, -a6);
 			return;
 		}
-		if (strcmp(op, "gxshow") == 0) {
-			show('x');
-			return;
-		}
-		break;
-	case 'H':
-		if (strcmp(op, "Hd") == 0) {
-			setxysym(op, D_Hd);
-			return;
-		}
-		if (strcmp(op, "HD") == 0) {
-			setxysym(op, D_HD);
+	case PS_gxshow:
+		show('x');
+		return;
+	case PS_idiv:
+		n = pop_free_val();
+		if (!stack || stack->type != VAL || n == 0) {
+			fprintf(stderr, "svg idiv: Bad value\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "HDD") == 0) {
-			setxysym(op, D_HDD);
+		n = (int) stack->u.v / n;
+		stack->u.v = n;
+		return;
+	case PS_if:
+		e = pop(SEQ);		/* sequence */
+		if (!e)
 			return;
-		}
-		break;
-	case 'h':
-		if (strcmp(op, "hd") == 0) {
-			setxysym(op, D_hd);
+		n = pop_free_val();	/* condition */
+		if (n != 0)
+			seq_exec(e);
+		elt_free(e);
+		return;
+	case PS_ifelse:
+		e2 = pop(SEQ);		/* sequence 2 */
+		e = pop(SEQ);		/* sequence 1 */
+		if (!e || !e2)
 			return;
+		n = pop_free_val();	/* condition */
+		if (n != 0)
+			seq_exec(e);
+		else
+			seq_exec(e2);
+		elt_free(e);
+		elt_free(e2);
+		return;
+	case PS_index:
+		n = pop_free_val();
+		e = stack;
+		while (--n >= 0) {
+			if (!e)
+				break;
+			e = e->next;
 		}
-		if (strcmp(op, "hl") == 0) {
-			xysym(op, D_hl);
+		if (!e) {
+			fprintf(stderr, "svg index: Stack empty\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "hl1") == 0) {
-			xysym(op, D_hl1);
+		e = elt_dup(e);
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "hl2") == 0) {
-			xysym(op, D_hl2);
+		push(e);
+		return;
+	case PS_jshow:
+		show('j');
+		return;
+	case PS_L:
+	case PS_lineto:
+		path_def();
+		y = pop_free_val();
+		x = pop_free_val();
+		if (x == gcur.cx)
+			path_print("\tv%.2f\n", gcur.cy - y);
+		else if (y == gcur.cy)
+			path_print("\th%.2f\n", x - gcur.cx);
+		else
+			path_print("\tl%.2f %.2f\n",
+				x - gcur.cx, gcur.cy - y);
+		gcur.cx = x;
+		gcur.cy = y;
+		return;
+	case PS_le:
+		cond(C_LE);
+		return;
+	case PS_lt:
+		cond(C_LT);
+		return;
+	case PS_length:
+		s = pop_free_str();
+		if (!s || *s != '(') {
+			fprintf(stderr, "svg length: No string\n");
+			if (s)
+				free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "hld") == 0) {
-			xysym(op, D_hld);
+		e = elt_new();
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "hyph") == 0) {
-			int d;
-
-			setg(1);
-			y = pop_free_val();
-			x = pop_free_val();
-			w = pop_free_val();
-			d = 25 + (int) w / 20 * 3;
-			n = (w - 15.) / d;
-			x += (w - d * n - 5) / 2;
-			fprintf(fout, "<path class=\"stroke\" stroke-width=\"1.2\"\n"
-				"	stroke-dasharray=\"5,%d\"\n"
-				"	d=\"M%.2f %.2fh%d\"/>\n",
-				d - 5,
-				gcur.xoffs + x, gcur.yoffs - y - gcur.font_s * 0.3,
-				d * n + 5);
+		e->type = VAL;
+		e->u.v = strlen(s + 1);
+		push(e);
+		free(s);
+		return;
+	case PS_load:
+		s = pop_free_str();
+		if (!s || *s != '/') {
+			fprintf(stderr, "svg load: No / bad symbol\n");
+			if (s)
+				free(s);
+			ps_error = 1;
 			return;
 		}
-		break;
-	case 'i':
-		if (strcmp(op, "idiv") == 0) {
-			n = pop_free_val();
-			if (!stack || stack->type != VAL || n == 0) {
-				fprintf(stderr, "svg idiv: Bad value\n");
-				ps_error = 1;
+		sym = ps_sym_lookup(s + 1);
+		if (!sym) {
+			e = elt_new();
+			if (!e)
 				return;
-			}
-			n = (int) stack->u.v / n;
-			stack->u.v = n;
-			return;
-		}
-		if (strcmp(op, "if") == 0) {
-			e = pop(SEQ);		/* sequence */
+			e->type = STR;
+			e->u.s = strdup(s);
+			e->u.s[0] = ' ';	/* internal */
+		} else {
+			e = elt_dup(sym->e);
 			if (!e)
 				return;
-			n = pop_free_val();	/* condition */
-			if (n != 0)
-				seq_exec(e);
-			elt_free(e);
-			return;
 		}
-		if (strcmp(op, "ifelse") == 0) {
-			e2 = pop(SEQ);		/* sequence 2 */
-			e = pop(SEQ);		/* sequence 1 */
-			if (!e || !e2)
-				return;
-			n = pop_free_val();	/* condition */
-			if (n != 0)
-				seq_exec(e);
-			else
-				seq_exec(e2);
-			elt_free(e);
-			elt_free(e2);
+		free(s);
+		push(e);
+		return;
+	case PS_lyshow:
+		show('s');
+		return;
+	case PS_moveto:
+		moveto();
+		return;
+	case PS_mod:
+		x = pop_free_val();
+		if (!stack || stack->type != VAL || x == 0) {
+			fprintf(stderr, "svg: Bad value for mod\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "imsig") == 0) {
-			xysym(op, D_imsig);
+		n = (int) stack->u.v % (int) x;
+		stack->u.v = n;
+		return;
+	case PS_mul:
+		x = pop_free_val();
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg: Bad value for mul\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "iMsig") == 0) {
-			xysym(op, D_iMsig);
+		stack->u.v *= x;
+		return;
+	case PS_ne:
+		cond(C_NE);
+		return;
+	case PS_neg:
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg: Bad value for neg\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "index") == 0) {
-			n = pop_free_val();
-			e = stack;
-			while (--n >= 0) {
-				if (!e)
-					break;
-				e = e->next;
-			}
-			if (!e) {
-				fprintf(stderr, "svg index: Stack empty\n");
-				ps_error = 1;
-				return;
-			}
-			e = elt_dup(e);
-			if (!e)
-				return;
-			push(e);
+		stack->u.v = -stack->u.v;
+		return;
+	case PS_newpath:
+//			path_def();
+		gcur.cx = NaN;
+		return;
+	case PS_or:
+		x = pop_free_val();
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg or: Bad value\n");
+			ps_error = 1;
 			return;
 		}
-		break;
-	case 'j':
-		if (strcmp(op, "jshow") == 0) {
-			show('j');
+		stack->u.v = (int) x & (int) stack->u.v;
+		return;
+	case PS_pf:
+		setg(1);
+		y = gcur.yoffs - pop_free_val() - 5;
+		x = gcur.xoffs + pop_free_val();
+		s = pop_free_str();
+		if (!s) {
+			fprintf(stderr, "svg pf: No string\n");
+			ps_error = 1;
 			return;
 		}
-		break;
-	case 'L':
-		if (strcmp(op, "L") == 0) {
-lineto:
-			path_def();
-			y = pop_free_val();
-			x = pop_free_val();
-			if (x == gcur.cx)
-				path_print("\tv%.2f\n", gcur.cy - y);
-			else if (y == gcur.cy)
-				path_print("\th%.2f\n", x - gcur.cx);
-			else
-				path_print("\tl%.2f %.2f\n",
-					x - gcur.cx, gcur.cy - y);
-			gcur.cx = x;
-			gcur.cy = y;
-			return;
-		}
-	case 'l':
-		if (strcmp(op, "le") == 0) {
-			cond(C_LE);
-			return;
-		}
-		if (strcmp(op, "lt") == 0) {
-			cond(C_LT);
-			return;
-		}
-		if (strcmp(op, "length") == 0) {
-			s = pop_free_str();
-			if (!s || *s != '(') {
-				fprintf(stderr, "svg length: No string\n");
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = strlen(s + 1);
-			push(e);
-			free(s);
-			return;
-		}
-		if (strcmp(op, "lineto") == 0)
-			goto lineto;
-		if (strcmp(op, "lmrd") == 0) {
-			xysym(op, D_lmrd);
-			return;
-		}
-		if (strcmp(op, "load") == 0) {
-			s = pop_free_str();
-			if (!s || *s != '/') {
-				fprintf(stderr, "svg load: No / bad symbol\n");
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-			sym = ps_sym_lookup(s + 1);
-			if (!sym) {
-				e = elt_new();
-				if (!e)
-					return;
-				e->type = STR;
-				e->u.s = strdup(s);
-				e->u.s[0] = ' ';	/* internal */
-			} else {
-				e = elt_dup(sym->e);
-				if (!e)
-					return;
-			}
-			free(s);
-			push(e);
-			return;
-		}
-		if (strcmp(op, "longa") == 0) {
-			setxysym(op, D_longa);
-			return;
-		}
-		if (strcmp(op, "lphr") == 0) {
-			xysym(op, D_lphr);
-			return;
-		}
-		if (strcmp(op, "ltr") == 0) {
-			arp_ltr('l');
-			return;
-		}
-		if (strcmp(op, "lyshow") == 0) {
-			show('s');
-			return;
-		}
-		break;
-	case 'M':
-		if (strcmp(op, "M") == 0) {
-moveto:
-			gcur.cy = pop_free_val();
-			gcur.cx = pop_free_val();
-			if (path) {
-				path_print("\tM%.2f %.2f\n",
-					gcur.xoffs + gcur.cx, gcur.yoffs - gcur.cy);
-			} else if (g == 2) {
-				fputs("</text>\n", fout);
-				g = 1;
-			}
-			return;
-		}
-		break;
-	case 'm':
-		if (strcmp(op, "marcato") == 0) {
-			xysym(op, D_marcato);
-			return;
-		}
-		if (strcmp(op, "moveto") == 0)
-			goto moveto;
-		if (strcmp(op, "mphr") == 0) {
-			xysym(op, D_mphr);
-			return;
-		}
-		if (strcmp(op, "mod") == 0) {
-			x = pop_free_val();
-			if (!stack || stack->type != VAL || x == 0) {
-				fprintf(stderr, "svg: Bad value for mod\n");
-				ps_error = 1;
-				return;
-			}
-			n = (int) stack->u.v % (int) x;
-			stack->u.v = n;
-			return;
-		}
-		if (strcmp(op, "mrep") == 0) {
-			xysym(op, D_mrep);
-			return;
-		}
-		if (strcmp(op, "mrep2") == 0) {
-			xysym(op, D_mrep2);
-			return;
-		}
-		if (strcmp(op, "mrest") == 0) {
-#if 1
-			xysym(op, D_mrest);
-			return;
-#else
-			def_use(D_mrest);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			s = pop_free_str();
-			if (!s) {
-				fprintf(stderr, "svg: No string\n");
-				ps_error = 1;
-				return;
-			}
-			fprintf(fout, "<use x=\"%.2f\" y=\"%.2f\" xlink:href=\"#mrest\"/>\n"
-				"<text style=\"font:bold 15px serif\"\n"
-				"	x=\"%.2f\" y=\"%.2f\" text-anchor=\"middle\">%s</text>\n",
-				x, y, x, y - 28, s + 1);
-			free(s);
-#endif
-			return;
-		}
-		if (strcmp(op, "mul") == 0) {
-			x = pop_free_val();
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg: Bad value for mul\n");
-				ps_error = 1;
-				return;
-			}
-			stack->u.v *= x;
-			return;
-		}
-		break;
-	case 'n':
-		if (strcmp(op, "ne") == 0) {
-			cond(C_NE);
-			return;
-		}
-		if (strcmp(op, "neg") == 0) {
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg: Bad value for neg\n");
-				ps_error = 1;
-				return;
-			}
-			stack->u.v = -stack->u.v;
-			return;
-		}
-		if (strcmp(op, "newpath") == 0) {
-//			path_def();
-			gcur.cx = NaN;
-			return;
-		}
-		if (strcmp(op, "nt0") == 0) {
-			xysym(op, D_nt0);
-			return;
-		}
-		break;
-	case 'o':
-		if (strcmp(op, "o8va") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 5;
-			x = gcur.xoffs + pop_free_val();
-			w = pop_free_val();
-			sym = ps_sym_lookup("defl");
-			if (!((int) sym->e->u.v & 1)) {
-				fprintf(fout,
-					"<text x=\"%.2f\" y=\"%.2f\""
-					" style=\"font:italic bold 12px serif\">8"
-					"<tspan dy=\"-4\""
-					" style=\"font-size:10px\">va</tspan></text>\n",
-					x - 5, y);
-				x += 14;
-				w -= 14;
-			} else {
-				w -= 5;
-			}
-			y -= 6;
-			fprintf(fout,
-				"<path class=\"stroke\" stroke-dasharray=\"6,6\""
-				" d=\"M%.2f %.2fh%.2f\"/>\n",
-				x, y, w);
-			if (!((int) sym->e->u.v & 2))
-				fprintf(fout, "<path class=\"stroke\""
-					" d=\"m%.2f %.2fv6\"/>\n",
-					x + w, y);
-
-			return;
-		}
-		if (strcmp(op, "o8vb") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 5;
-			x = gcur.xoffs + pop_free_val();
-			w = pop_free_val();
-			sym = ps_sym_lookup("defl");
-			if (!((int) sym->e->u.v & 1)) {
-				fprintf(fout,
-					"<text x=\"%.2f\" y=\"%.2f\""
-					" style=\"font:italic bold 12px serif\">8"
-					"<tspan dy=\"-4\""
-					" style=\"font-size:10px\">vb</tspan></text>\n",
-					x - 5, y);
-				x += 8;
-				w -= 8;
-			} else {
-				w -= 5;
-			}
-			fprintf(fout,
-				"<path class=\"stroke\" stroke-dasharray=\"6,6\""
-				" d=\"M%.2f %.2fh%.2f\"/>\n",
-				x, y, w);
-			if (!((int) sym->e->u.v & 2))
-				fprintf(fout, "<path class=\"stroke\""
-					" d=\"m%.2f %.2fv-6\"/>\n",
-					x + w, y);
-
-			return;
-		}
-		if (strcmp(op, "oct") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			fprintf(fout, "<text style=\"font:12px serif\"\n"
-				"	x=\"%.2f\" y=\"%.2f\">8</text>\n",
-				x, y);
-			return;
-		}
-		if (strcmp(op, "opend") == 0) {
-			xysym(op, D_opend);
-			return;
-		}
-		if (strcmp(op, "or") == 0) {
-			x = pop_free_val();
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg or: Bad value\n");
-				ps_error = 1;
-				return;
-			}
-			stack->u.v = (int) x & (int) stack->u.v;
-			return;
-		}
-		break;
-	case 'p':
-		if (strcmp(op, "pclef") == 0) {
-			xysym(op, D_pclef);
-			return;
-		}
-		if (strcmp(op, "ped") == 0) {
-			xysym(op, D_ped);
-			return;
-		}
-		if (strcmp(op, "pedoff") == 0) {
-			xysym(op, D_pedoff);
-			return;
-		}
-		if (strcmp(op, "pf") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 5;
-			x = gcur.xoffs + pop_free_val();
-			s = pop_free_str();
-			if (!s) {
-				fprintf(stderr, "svg pf: No string\n");
-				ps_error = 1;
-				return;
-			}
-			fprintf(fout, "<text style=\"font:bold italic 16px serif\"\n"
-				"	x=\"%.2f\" y=\"%.2f\">%s</text>\n",
-				x, y, s + 1);
-			free(s);
-			return;
-		}
-		if (strcmp(op, "pmsig") == 0) {
-			xysym(op, D_pmsig);
-			return;
-		}
-		if (strcmp(op, "pMsig") == 0) {
-			xysym(op, D_pMsig);
-			return;
-		}
-		if (strcmp(op, "pop") == 0) {
-			if (!stack) {
-				fprintf(stderr, "svg pop: Stack empty\n");
-				ps_error = 1;
-				return;
-			}
-			e = pop(stack->type);
-			elt_free(e);
-			return;
-		}
-		if (strcmp(op, "pshhd") == 0) {
-			setxysym(op, D_pshhd);
-			return;
-		}
-		if (strcmp(op, "pdshhd") == 0) {
-			setxysym("pshhd", D_pshhd);
-			return;
-		}
-		if (strcmp(op, "pfthd") == 0) {
-			setxysym(op, D_pfthd);
-			return;
-		}
-		if (strcmp(op, "pdfthd") == 0) {
-			setxysym("pfthd", D_pfthd);
+		svg_printf("<text style=\"font:bold italic 16px serif\"\n"
+			"	x=\"%.2f\" y=\"%.2f\">%s</text>\n",
+			x, y, s + 1);
+		free(s);
+		return;
+	case PS_pop:
+		if (!stack) {
+			fprintf(stderr, "svg pop: Stack empty\n");
+			ps_error = 1;
 			return;
 		}
+		e = pop(stack->type);
+		elt_free(e);
+		return;
+	case PS_pdshhd:
+		setxysym("pshhd", D_pshhd);
+		return;
+	case PS_pdfthd:
+		setxysym("pfthd", D_pfthd);
+		return;
 #if 0
 //fixme: cannot work because duplication...
-		if (strcmp(op, "put") == 0) {
+	case PS_put: {
 			int v;
 
 			v = pop_free_val();
@@ -3366,12 +3977,10 @@ moveto:
 			return;
 		}
 #endif
-		break;
-	case 'R':
-		if (strcmp(op, "RC") == 0) {
+	case PS_RC:
+	case PS_rcurveto: {
 			float c1, c2, c3, c4;
 
-rcurveto:
 			path_def();
 			y = pop_free_val();
 			x = pop_free_val();
@@ -3385,88 +3994,13 @@ rcurveto:
 			gcur.cy += y;
 			return;
 		}
-		if (strcmp(op, "RL") == 0) {
-rlineto:
-			path_def();
-			y = pop_free_val();
-			x = pop_free_val();
-			if (x == 0)
-				path_print("\tv%.2f\n", -y);
-			else if (y == 0)
-				path_print("\th%.2f\n", x);
-			else
-				path_print("\tl%.2f %.2f\n", x, -y);
-			gcur.cx += x;
-			gcur.cy += y;
-			return;
-		}
-		if (strcmp(op, "RM") == 0) {
-rmoveto:
-			y = pop_free_val();
-			x = pop_free_val();
-			if (path) {
-				path_print("\tm%.2f %.2f\n", x, -y);
-			} else if (g == 2) {
-				fputs("</text>\n", fout);
-				g = 1;
-			}
-			gcur.cx += x;
-			gcur.cy += y;
-			return;
-		}
-		break;
-	case 'r':
-		if (strcmp(op, "r00") == 0) {
-			setxysym(op, D_r00);
-			return;
-		}
-		if (strcmp(op, "r0") == 0) {
-			setxysym(op, D_r0);
-			return;
-		}
-		if (strcmp(op, "r1") == 0) {
-			setxysym(op, D_r1);
-			return;
-		}
-		if (strcmp(op, "r2") == 0) {
-			setxysym(op, D_r2);
-			return;
-		}
-		if (strcmp(op, "r4") == 0) {
-			setxysym(op, D_r4);
-			return;
-		}
-		if (strcmp(op, "r8") == 0) {
-			setxysym(op, D_r8);
-			return;
-		}
-		if (strcmp(op, "r16") == 0) {
-			setxysym(op, D_r16);
-			return;
-		}
-		if (strcmp(op, "r32") == 0) {
-			setxysym(op, D_r32);
-			return;
-		}
-		if (strcmp(op, "r64") == 0) {
-			setxysym(op, D_r64);
-			return;
-		}
-		if (strcmp(op, "r128") == 0) {
-			setxysym(op, D_r128);
-			return;
-		}
-		if (strcmp(op, "rdots") == 0) {
-			xysym(op, D_rdots);
-			return;
-		}
-		if (strcmp(op, "rcurveto") == 0)
-			goto rcurveto;
-		if (strcmp(op, "rlineto") == 0)
-			goto rlineto;
-		if (strcmp(op, "rmoveto") == 0)
-			goto rmoveto;
-		if (strcmp(op, "roll") == 0) {
+	case PS_rlineto:
+		rlineto();
+		return;
+	case PS_rmoveto:
+		rmoveto();
+		return;
+	case PS_roll: {
 			int i, j;
 
 			j = pop_free_val();
@@ -3520,7 +4054,7 @@ rmoveto:
 			}
 			return;
 		}
-		if (strcmp(op, "repbra") == 0) {
+	case PS_repbra: {
 			int i;
 
 			setg(1);
@@ -3535,43 +4069,42 @@ rmoveto:
 				ps_error = 1;
 				return;
 			}
-			fprintf(fout,
+			svg_printf(
 				"<text x=\"%.2f\" y=\"%.2f\">",
 				x + 4, y - h);
 			xml_str_out(s + 1);
-			fprintf(fout,
+			svg_printf(
 				"</text>\n"
 				"<path class=\"stroke\"\n"
 				"	d=\"M%.2f %.2f",
 				x, y);
 			if (i & 1)
-				fprintf(fout, "m0 20v-20");
-			fprintf(fout, "h%.2f", w);
+				svg_printf("m0 20v-20");
+			svg_printf("h%.2f", w);
 			if (i & 2)
-				fprintf(fout, "v20");
-			fprintf(fout, "\"/>\n");
+				svg_printf("v20");
+			svg_printf("\"/>\n");
 			free(s);
 			return;
 		}
-		if (strcmp(op, "repeat") == 0) {
-			e = pop(SEQ);		/* sequence */
-			if (!e)
-				return;
-			n = pop_free_val();	/* n times */
-			if ((unsigned) n >= 100) {
-				fprintf(stderr, "svg repeat: Too high value\n");
-				ps_error = 1;
-			}
-			while (--n >= 0) {
-				if (seq_exec(e))
-					break;		/* exit */
-				if (ps_error)
-					break;
-			}
-			elt_free(e);
+	case PS_repeat:
+		e = pop(SEQ);		/* sequence */
+		if (!e)
 			return;
+		n = pop_free_val();	/* n times */
+		if ((unsigned) n >= 100) {
+			fprintf(stderr, "svg repeat: Too high value\n");
+			ps_error = 1;
 		}
-		if (strcmp(op, "rotate") == 0) {
+		while (--n >= 0) {
+			if (seq_exec(e))
+				break;		/* exit */
+			if (ps_error)
+				break;
+		}
+		elt_free(e);
+		return;
+	case PS_rotate: {
 			float x, y, _sin, _cos;
 
 			setg(0);
@@ -3604,9 +4137,7 @@ rmoveto:
 			gcur.yoffs = -(x * _sin + y * _cos);	// SVG orientation
 			return;
 		}
-		break;
-	case 'S':
-		if (strcmp(op, "SL") == 0) {
+	case PS_SL: {
 			float c1, c2, c3, c4, c5, c6, l2;
 			float a1, a2, a3, a4, a5, a6, m1, m2;
 
@@ -3627,7 +4158,7 @@ rmoveto:
 			c3 = pop_free_val();
 			c2 = pop_free_val();
 			c1 = pop_free_val();
-			fprintf(fout,
+			svg_printf(
 				"<path class=\"fill\"\n"
 				"	d=\"M%.2f %.2fc%.2f %.2f %.2f %.2f %.2f %.2f\n"
 				"	v%.2fc%.2f %.2f %.2f %.2f %.2f %.2f\"/>\n",
@@ -3635,28 +4166,20 @@ rmoveto:
 				-l2, c1, -c2, c3, -c4, c5, -c6);
 			return;
 		}
-		if (strcmp(op, "SLW") == 0) {
-			gcur.linewidth = pop_free_val();
-			return;
-		}
-		break;
-	case 's':
-		if (strcmp(op, "scale") == 0) {
-			y = pop_free_val();
-			x = pop_free_val();
-			gcur.xoffs /= x;
-			gcur.yoffs /= y;
-			gcur.cx /= x;
-			gcur.cy /= y;
-			gcur.xscale *= x;
-			gcur.yscale *= y;
-			return;
-		}
-		if (strcmp(op, "scalefont") == 0) {
-			gcur.font_s = pop_free_val();
-			return;
-		}
-		if (strcmp(op, "search") == 0) {
+	case PS_scale:
+		y = pop_free_val();
+		x = pop_free_val();
+		gcur.xoffs /= x;
+		gcur.yoffs /= y;
+		gcur.cx /= x;
+		gcur.cy /= y;
+		gcur.xscale *= x;
+		gcur.yscale *= y;
+		return;
+	case PS_scalefont:
+		gcur.font_s = pop_free_val();
+		return;
+	case PS_search: {
 			char *p;
 
 			e = pop(STR);			/* seek */
@@ -3700,555 +4223,185 @@ rmoveto:
 				e->type = VAL;
 				e->u.v = 0;
 			}
-			push(e);
-			return;
-		}
-		if (strcmp(op, "selectfont") == 0) {
-			h = pop_free_val();
-			s = pop_free_str();
-			if (!s
-			 || *s != '/') {
-				fprintf(stderr, "svg selectfont: No / bad font\n");
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-			if (gcur.font_s != h
-			 || strcmp(s, gcur.font_n) != 0) {
-				free(gcur.font_n_old);
-				gcur.font_n_old = gcur.font_n;
-				gcur.font_n = strdup(s);
-				gcur.font_s = h;
-				gold.font_n = NULL;
-			} else {
-				free(s);
-			}
-			return;
-		}
-		if (strcmp(op, "sep0") == 0) {
-			x = pop_free_val();
-			w = pop_free_val();
-			fprintf(fout,
-				"<path class=\"stroke\"\n"
-				"	d=\"M%.2f %.2fh%.2f\"/>\n",
-					gcur.xoffs + x, gcur.yoffs, w);
-			return;
-		}
-		if (strcmp(op, "setdash") == 0) {
-			char *p;
-
-			n = pop_free_val();
-			e = pop(BRK);
-			if (!e) {
-				fprintf(stderr, "svg setdash: Bad pattern\n");
-				ps_error = 1;
-				return;
-			}
-			e = e->u.e;
-			if (!e) {
-				gcur.dash[0] = '\0';
-				return;
-			}
-			p = gcur.dash;
-			if (n != 0)
-				p += sprintf(p, " stroke-dashoffset=\"%d\"", n);
-			p += sprintf(p, " stroke-dasharray=\"");
-			do {
-				if (e->type != VAL) {
-					fprintf(stderr, "svg setdash: Bad pattern type\n");
-					ps_error = 1;
-					return;
-				}
-				if (p >= &gcur.dash[sizeof gcur.dash] - 10) {
-					fprintf(stderr, "svg setdash: Pattern too wide\n");
-					ps_error = 1;
-					return;
-				}
-				p += sprintf(p, "%d,", (int) e->u.v);
-				e = e->next;
-			} while (e);
-			p--;
-			sprintf(p, "\"");
-			return;
-		}
-		if (strcmp(op, "setfont") == 0) {
-			return;
-		}
-		if (strcmp(op, "setgray") == 0) {
-			n = pop_free_val() * 255;
-			gcur.rgb = (n << 16) | (n << 8) | n;
-			return;
-		}
-		if (strcmp(op, "setlinewidth") == 0) {
-			gcur.linewidth = pop_free_val();
-			return;
-		}
-//fixme: use 'use' for flags
-		if (strcmp(op, "sfu") == 0) {
-			setg(1);
-			h = pop_free_val();
-			n = pop_free_val();
-			sym = ps_sym_lookup("x");
-			x = gcur.xoffs + sym->e->u.v + 3.5;
-			sym = ps_sym_lookup("y");
-			y = gcur.yoffs - sym->e->u.v;
-			fprintf(fout,
-				"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
-				"<path class=\"fill\"\n"
-				"	d=\"",
-				x, y, -h);
-			y -= h;
-			if (n == 1) {
-				fprintf(fout,
-					"M%.2f %.2fc0.6 5.6 9.6 9 5.6 18.4\n"
-					"	1.6 -6 -1.3 -11.6 -5.6 -12.8\n",
-					x, y);
-			} else {
-				while (--n >= 0) {
-					fprintf(fout,
-						"M%.2f %.2fc0.9 3.7 9.1 6.4 6 12.4\n"
-						"	1 -5.4 -4.2 -8.4 -6 -8.4\n",
-						x, y);
-					y += 5.4;
-				}
-			}
-			fprintf(fout, "\"/>\n");
-			return;
-		}
-		if (strcmp(op, "sfd") == 0) {
-			setg(1);
-			h = pop_free_val();
-			n = pop_free_val();
-			sym = ps_sym_lookup("x");
-			x = gcur.xoffs + sym->e->u.v - 3.5;
-			sym = ps_sym_lookup("y");
-			y = gcur.yoffs - sym->e->u.v;
-			fprintf(fout,
-				"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
-				"<path class=\"fill\"\n"
-				"	d=\"",
-				x, y, -h);
-			y -= h;
-			if (n == 1) {
-				fprintf(fout,
-					"M%.2f %.2fc0.6 -5.6 9.6 -9 5.6 -18.4\n"
-					"	1.6 6 -1.3 11.6 -5.6 12.8\n",
-					x, y);
-			} else {
-				while (--n >= 0) {
-					fprintf(fout,
-						"M%.2f %.2fc0.9 -3.7 9.1 -6.4 6 -12.4\n"
-						"	1 5.4 -4.2 8.4 -6 8.4\n",
-						x, y);
-					y -= 5.4;
-				}
-			}
-			fprintf(fout, "\"/>\n");
-			return;
-		}
-		if (strcmp(op, "sfs") == 0) {
-			setg(1);
-			h = pop_free_val();
-			n = pop_free_val();
-			sym = ps_sym_lookup("x");
-			x = gcur.xoffs + sym->e->u.v;
-			sym = ps_sym_lookup("y");
-			y = gcur.yoffs - sym->e->u.v - 1;
-			if (h > 0) {
-				x += 3.5;
-				y -= 1;
-				fprintf(fout,
-					"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
-					"<path class=\"fill\"\n"
-					"	d=\"",
-					x, y, -h + 1);
-				y -= h - 1;
-				while (--n >= 0) {
-					fprintf(fout,
-						"M%.2f %.2fl7 3.2 0 3.2 -7 -3.2z\n",
-						x, y);
-					y += 5.4;
-				}
-			} else {
-				x -= 3.5;
-				y += 1;
-				fprintf(fout,
-					"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
-					"<path class=\"fill\"\n"
-					"	d=\"",
-					x, y, -h - 1);
-				y -= h + 1;
-				while (--n >= 0) {
-					fprintf(fout,
-						"M%.2f %.2fl7 -3.2 0 -3.2 -7 3.2z\n",
-						x, y);
-					y -= 5.4;
-				}
-			}
-			fprintf(fout, "\"/>\n");
-			return;
-		}
-		if (strcmp(op, "sgu") == 0) {
-			setg(1);
-			h = pop_free_val();
-			n = pop_free_val();
-			sym = ps_sym_lookup("x");
-			x = gcur.xoffs + sym->e->u.v + GSTEM_XOFF;
-			sym = ps_sym_lookup("y");
-			y = gcur.yoffs - sym->e->u.v;
-			fprintf(fout,
-				"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
-				"<path class=\"fill\"\n"
-				"	d=\"",
-				x, y, -h);
-			y -= h;
-			if (n == 1) {
-				fprintf(fout,
-					"M%.2f %.2fc0.6 3.4 5.6 3.8 3 10\n"
-					"	1.2 -4.4 -1.4 -7 -3 -7\n",
-					x, y);
-			} else {
-				while (--n >= 0) {
-					fprintf(fout,
-						"M%.2f %.2fc1 3.2 5.6 2.8 3.2 8\n"
-						"	1.4 -4.8 -2.4 -5.4 -3.2 -5.2\n",
-					x, y);
-					y += 3.5;
-				}
-			}
-			fprintf(fout, "\"/>\n");
-			return;
-		}
-		if (strcmp(op, "sgd") == 0) {
-			setg(1);
-			h = pop_free_val();
-			n = pop_free_val();
-			sym = ps_sym_lookup("x");
-			x = gcur.xoffs + sym->e->u.v - GSTEM_XOFF;
-			sym = ps_sym_lookup("y");
-			y = gcur.yoffs - sym->e->u.v;
-			fprintf(fout,
-				"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
-				"<path class=\"fill\"\n"
-				"	d=\"",
-				x, y, -h);
-			y -= h;
-			if (n == 1) {
-				fprintf(fout,
-					"M%.2f %.2fc0.6 -3.4 5.6 -3.8 3 -10\n"
-					"	1.2 4.4 -1.4 7 -3 7\n",
-					x, y);
-			} else {
-				while (--n >= 0) {
-					fprintf(fout,
-						"M%.2f %.2fc1 -3.2 5.6 -2.8 3.2 -8\n"
-						"	1.4 4.8 -2.4 5.4 -3.2 5.2\n",
-						x, y);
-					y -= 3.5;
-				}
-			}
-			fprintf(fout, "\"/>\n");
-			return;
-		}
-		if (strcmp(op, "sgs") == 0) {
-			setg(1);
-			h = pop_free_val();
-			n = pop_free_val();
-			sym = ps_sym_lookup("x");
-			x = gcur.xoffs + sym->e->u.v + GSTEM_XOFF;
-			sym = ps_sym_lookup("y");
-			y = gcur.yoffs - sym->e->u.v;
-			fprintf(fout,
-				"<path d=\"M%.2f %.2fv%.2f\" class=\"stroke\"/>\n"
-				"<path class=\"fill\"\n"
-				"	d=\"",
-				x, y, -h);
-			y -= h;
-			while (--n >= 0) {
-				fprintf(fout,
-					"M%.2f %.2fl3 1.5 0 2 -3 -1.5z\n",
-					x, y);
-				y += 3;
-			}
-			fprintf(fout, "\"/>\n");
-			return;
-		}
-		if (strcmp(op, "sfz") == 0) {
-			xysym(op, D_sfz);
-			s = pop_free_str();
-			if (s)
-				free(s);
-			return;
-		}
-		if (strcmp(op, "sgno") == 0) {
-			xysym(op, D_sgno);
-			return;
-		}
-		if (strcmp(op, "show") == 0) {
-			show('s');
-			return;
-		}
-		if (strcmp(op, "showb") == 0) {
-			show('b');
-			return;
-		}
-		if (strcmp(op, "showc") == 0) {
-			show('c');
-			return;
-		}
-		if (strcmp(op, "showr") == 0) {
-			show('r');
-			return;
-		}
-		if (strcmp(op, "showerror") == 0) {
-			xysym(op, D_showerror);
-			return;
-		}
-		if (strcmp(op, "sld") == 0) {
-			xysym(op, D_sld);
-			return;
-		}
-		if (strcmp(op, "snap") == 0) {
-			xysym(op, D_snap);
-			return;
-		}
-		if (strcmp(op, "sphr") == 0) {
-			xysym(op, D_sphr);
-			return;
-		}
-		if (strcmp(op, "spclef") == 0) {
-			xysym(op + 1, D_pclef);		// same as 'pclef'
-			return;
-		}
-		if (strcmp(op, "setrgbcolor") == 0) {
-			int rgb;
-
-			rgb = pop_free_val() * 255;
-			rgb += (int) (pop_free_val() * 255) << 8;
-			rgb += (int) (pop_free_val() * 255) << 16;
-			gcur.rgb = rgb;
-			return;
-		}
-		if (strcmp(op, "stc") == 0) {
-			xysym(op, D_stc);
-			return;
-		}
-		if (strcmp(op, "stroke") == 0) {
-			if (!path) {
-				fprintf(stderr, "svg: 'stroke' with no path\n");
-//				ps_error = 1;
-				return;
-			}
-			path_end();
-			fprintf(fout, "\t\" class=\"stroke\"%s/>\n",
-					gcur.dash);
-			return;
-		}
-		if (strcmp(op, "su") == 0
-		 || strcmp(op, "sd") == 0) {
-			stem(op);
-			return;
-		}
-		if (strcmp(op, "stsig") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val();
-			s = pop_free_str();
-			if (!s) {
-				fprintf(stderr, "svg: No string\n");
-				ps_error = 1;
-				return;
-			}
-			fprintf(fout, "<g style=\"font:bold 18px serif\"\n"
-				"	transform=\"translate(%.2f,%.2f) scale(1.2,1)\">\n"
-				"	<text y=\"-7\" text-anchor=\"middle\">%s</text>\n"
-				"</g>\n",
-				x, y, s + 1);
-			free(s);
-			return;
-		}
-		if (strcmp(op, "sub") == 0) {
-			x = pop_free_val();
-			if (!stack || stack->type != VAL) {
-				fprintf(stderr, "svg: Bad value for sub\n");
-				ps_error = 1;
-				return;
-			}
-			stack->u.v -= x;
-			return;
-		}
-		if (strcmp(op, "sbclef") == 0) {
-			xysym(op, D_sbclef);
-			return;
-		}
-		if (strcmp(op, "scclef") == 0) {
-			xysym(op, D_scclef);
-			return;
-		}
-		if (strcmp(op, "sh0") == 0) {
-			xysym(op, D_sh0);
-			return;
-		}
-		if (strcmp(op, "sh1") == 0) {
-			xysym(op, D_sh1);
-			return;
-		}
-		if (strcmp(op, "sh4") == 0) {
-			n = pop_free_val();
-			switch (n) {
-			case 1:
-				xysym("sh1", D_sh1);
-				break;
-			case 2:
-				xysym("sh0", D_sh0);
-				break;
-			case 3:
-				xysym("sh513", D_sh513);
-				break;
-			default:
-				xysym("dsh0", D_dsh0);
-				break;
-			}
-			return;
-		}
-		if (strcmp(op, "sh513") == 0) {
-			xysym(op, D_sh513);
-			return;
-		}
-		if (strcmp(op, "srep") == 0) {
-			xysym(op, D_srep);
-			return;
-		}
-		if (strcmp(op, "stclef") == 0) {
-			xysym(op, D_stclef);
-			return;
-		}
-		if (strcmp(op, "stringwidth") == 0) {
-			s = pop_free_str();
-			if (!s || *s != '(') {
-				fprintf(stderr, "svg stringwidth: No string\n");
-				ps_error = 1;
-				return;
-			}
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = strw(s + 1);
-			push(e);
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = gcur.font_s;
-			push(e);
-			return;
-		}
-		if (strcmp(op, "svg") == 0) {
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = 1;
-			push(e);
-			return;
-		}
-		break;
-	case 'T':
-		if (strcmp(op, "T") == 0) {
-translate:
-//fixme:test
-//			setg(1);
-			y = pop_free_val();
-			x = pop_free_val();
-			gcur.xoffs += x;
-			gcur.yoffs -= y;
-			gcur.cx -= x;
-			gcur.cy -= y;
-			return;
-		}
-		break;
-	case 't':
-		if (strcmp(op, "tclef") == 0) {
-			xysym(op, D_tclef);
+			push(e);
 			return;
 		}
-		if (strcmp(op, "thbar") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val() + 1.5;
-			h = pop_free_val();
-			fprintf(fout,
-				"<path class=\"stroke\" stroke-width=\"3\"\n"
-				"	d=\"M%.2f %.2fv%.2f\"/>\n",
-				x, y, -h);
+	case PS_selectfont:
+		h = pop_free_val();
+		s = pop_free_str();
+		if (!s
+		 || *s != '/') {
+			fprintf(stderr, "svg selectfont: No / bad font\n");
+			if (s)
+				free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "thumb") == 0) {
-			xysym(op, D_thumb);
-			return;
+		if (gcur.font_s != h
+		 || strcmp(s, gcur.font_n) != 0) {
+			free(gcur.font_n_old);
+			gcur.font_n_old = gcur.font_n;
+			gcur.font_n = strdup(s);
+			gcur.font_s = h;
+			gold.font_n = NULL;
+		} else {
+			free(s);
 		}
-		if (strcmp(op, "translate") == 0)
-			goto translate;
-		if (strcmp(op, "trem") == 0) {
-			setg(1);
-			y = gcur.yoffs - pop_free_val();
-			x = gcur.xoffs + pop_free_val() - 4.5;
+		return;
+	case PS_sep0:
+		x = pop_free_val();
+		w = pop_free_val();
+		svg_printf(
+			"<path class=\"stroke\"\n"
+			"	d=\"M%.2f %.2fh%.2f\"/>\n",
+				gcur.xoffs + x, gcur.yoffs, w);
+		return;
+	case PS_setdash: {
+			char *p;
+
 			n = pop_free_val();
-			fprintf(fout, "<path class=\"fill\" d=\"m%.2f %.2f\n\t",
-				x, y);
-			for (;;) {
-				fputs("l9 -3v3l-9 3z", fout);
-				if (--n <= 0)
-					break;
-				fputs("m0 5.4", fout);
+			e = pop(BRK);
+			if (!e) {
+				fprintf(stderr, "svg setdash: Bad pattern\n");
+				ps_error = 1;
+				return;
+			}
+			e = e->u.e;
+			if (!e) {
+				gcur.dash[0] = '\0';
+				return;
 			}
-			fputs("\"/>", fout);
+			p = gcur.dash;
+			if (n != 0)
+				p += sprintf(p, " stroke-dashoffset=\"%d\"", n);
+			p += sprintf(p, " stroke-dasharray=\"");
+			do {
+				if (e->type != VAL) {
+					fprintf(stderr, "svg setdash: Bad pattern type\n");
+					ps_error = 1;
+					return;
+				}
+				if (p >= &gcur.dash[sizeof gcur.dash] - 10) {
+					fprintf(stderr, "svg setdash: Pattern too wide\n");
+					ps_error = 1;
+					return;
+				}
+				p += sprintf(p, "%d,", (int) e->u.v);
+				e = e->next;
+			} while (e);
+			p--;
+			sprintf(p, "\"");
 			return;
 		}
-		if (strcmp(op, "trl") == 0) {
-			xysym(op, D_trl);
+	case PS_setfont:
+		return;
+	case PS_setgray:
+		n = pop_free_val() * 255;
+		gcur.rgb = (n << 16) | (n << 8) | n;
+		return;
+	case PS_setlinewidth:
+		gcur.linewidth = pop_free_val();
+		return;
+//fixme: use 'use' for flags
+	case PS_sfz:
+		xysym(op, D_sfz);
+		s = pop_free_str();
+		if (s)
+			free(s);
+		return;
+	case PS_showb:
+		show('b');
+		return;
+	case PS_setrgbcolor: {
+			int rgb;
+
+			rgb = pop_free_val() * 255;
+			rgb += (int) (pop_free_val() * 255) << 8;
+			rgb += (int) (pop_free_val() * 255) << 16;
+			gcur.rgb = rgb;
 			return;
 		}
-		if (strcmp(op, "true") == 0) {
-			e = elt_new();
-			if (!e)
-				return;
-			e->type = VAL;
-			e->u.v = 1;
-			push(e);
+	case PS_sub:
+		x = pop_free_val();
+		if (!stack || stack->type != VAL) {
+			fprintf(stderr, "svg: Bad value for sub\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "tsig") == 0) {
-			char *d;
-
-			setg(1);
-			y = gcur.yoffs - pop_free_val() - 0.5;
-			x = gcur.xoffs + pop_free_val();
-			d = pop_free_str();
-			s = pop_free_str();
-			if (!d || !s) {
-				fprintf(stderr, "svg: No string\n");
-				if (d)
-					free(d);
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-			fprintf(fout, "<g style=\"font:bold 16px serif\"\n"
-				"	transform=\"translate(%.2f,%.2f) scale(1.2,1)\">\n"
-				"	<text text-anchor=\"middle\">%s</text>\n"
-				"	<text y=\"-12\" text-anchor=\"middle\">%s</text>\n"
-				"</g>\n",
-				x, y, d + 1, s + 1);
-			free(d);
-			free(s);
+		stack->u.v -= x;
+		return;
+	case PS_sh1:
+		xysym(op, D_sh1);
+		return;
+	case PS_sh4:
+		n = pop_free_val();
+		switch (n) {
+		case 1:
+			xysym("sh1", D_sh1);
+			break;
+		case 2:
+			xysym("sh0", D_sh0);
+			break;
+		case 3:
+			xysym("sh513", D_sh513);
+			break;
+		default:
+			xysym("dsh0", D_dsh0);
+			break;
+		}
+		return;
+	case PS_sh513:
+		xysym(op, D_sh513);
+		return;
+	case PS_stringwidth:
+		s = pop_free_str();
+		if (!s || *s != '(') {
+			fprintf(stderr, "svg stringwidth: No string\n");
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "tubr") == 0
-		 || strcmp(op, "tubrl") == 0) {
+		e = elt_new();
+		if (!e)
+			return;
+		e->type = VAL;
+		e->u.v = strw(s + 1);
+		push(e);
+		e = elt_new();
+		if (!e)
+			return;
+		e->type = VAL;
+		e->u.v = gcur.font_s;
+		push(e);
+		return;
+	case PS_svg:
+		e = elt_new();
+		if (!e)
+			return;
+		e->type = VAL;
+		e->u.v = 1;
+		push(e);
+		return;
+	case PS_T:
+	case PS_translate:
+//fixme:test
+//			setg(1);
+		y = pop_free_val();
+		x = pop_free_val();
+		gcur.xoffs += x;
+		gcur.yoffs -= y;
+		gcur.cx -= x;
+		gcur.cy -= y;
+		return;
+	case PS_true:
+		e = elt_new();
+		if (!e)
+			return;
+		e->type = VAL;
+		e->u.v = 1;
+		push(e);
+		return;
+	case PS_tubr:
+	case PS_tubrl: {
 			float dx, dy;
 			int h;
 
@@ -4264,93 +4417,68 @@ translate:
 				h = -3;
 				y += 3;
 			}
-			fprintf(fout,
+			svg_printf(
 				"<path class=\"stroke\"\n"
 				"	d=\"M%.2f %.2fv%dl%.2f %.2fv%d\"/>\n",
 				x, y, h, dx, -dy, -h);
 			return;
 		}
-		if (strcmp(op, "turn") == 0) {
-			xysym(op, D_turn);
-			return;
-		}
-		if (strcmp(op, "turnx") == 0) {
-			xysym(op, D_turnx);
-			return;
-		}
-		break;
-	case 'u':
-		if (strcmp(op, "upb") == 0) {
-			xysym(op, D_upb);
-			return;
-		}
-		if (strcmp(op, "umrd") == 0) {
-			xysym(op, D_umrd);
-			return;
-		}
-		break;
-	case 'w':
-		if (strcmp(op, "wedge") == 0) {
-			xysym(op, D_wedge);
+	case PS_where:
+		s = pop_free_str();		/* symbol */
+		if (!s || *s != '/') {
+			fprintf(stderr, "svg where: No / bad symbol\n");
+			if (s)
+				free(s);
+			ps_error = 1;
 			return;
 		}
-		if (strcmp(op, "wln") == 0) {
-			setg(1);
-			y = pop_free_val();
-			x = pop_free_val();
-			w = pop_free_val();
-			fprintf(fout, "<path class=\"stroke\" stroke-width=\"0.8\"\n"
-				"	d=\"M%.2f %.2fh%.2f\"/>\n",
-				gcur.xoffs + x, gcur.yoffs - y, w);
+		e = elt_new();
+		if (!e)
 			return;
-		}
-		if (strcmp(op, "where") == 0) {
-			s = pop_free_str();		/* symbol */
-			if (!s || *s != '/') {
-				fprintf(stderr, "svg where: No / bad symbol\n");
-				if (s)
-					free(s);
-				ps_error = 1;
-				return;
-			}
-			e = elt_new();
-			if (!e)
+		e->type = VAL;
+		sym = ps_sym_lookup(&s[1]);
+		if (!sym) {
+			e->u.v = 0;
+		} else {
+			e->u.v = 1;
+			e2 = elt_new();		/* dictionnary */
+			if (!e2)
 				return;
-			e->type = VAL;
-			sym = ps_sym_lookup(&s[1]);
-			if (!sym) {
-				e->u.v = 0;
-			} else {
-				e->u.v = 1;
-				e2 = elt_new();		/* dictionnary */
-				if (!e2)
-					return;
-				e2->type = VAL;
-				e2->u.v = 0;
-				push(e2);
-			}
-			free(s);
-			push(e);
-			return;
+			e2->type = VAL;
+			e2->u.v = 0;
+			push(e2);
 		}
-		break;
-	case 'x':
-		if (strcmp(op, "xydef") == 0) {
-			y = pop_free_val();
-			x = pop_free_val();
-			setxory("x", x);
-			setxory("y", y);
+		free(s);
+		push(e);
+		return;
+	case PS_xymove:
+		gcur.cy = pop_free_val();
+		gcur.cx = pop_free_val();
+		setxory("x", gcur.cx);
+		setxory("y", gcur.cy);
+		return;
+	default:
+		if (ps->op >= 0) {		/* drawing operation */
+			op_draw(ps->op);
 			return;
 		}
-		if (strcmp(op, "xymove") == 0) {
-			gcur.cy = pop_free_val();
-			gcur.cx = pop_free_val();
-			setxory("x", gcur.cx);
-			setxory("y", gcur.cy);
+		if (sscanf(op, "F%d", &n) == 1) {
+			h = pop_free_val();
+			if (!fontnames[n])
+				break;
+			if (gcur.font_s != h
+			 || strcmp(fontnames[n], gcur.font_n) != 0) {
+				free(gcur.font_n_old);
+				gcur.font_n_old = gcur.font_n;
+				gcur.font_n = strdup(fontnames[n]);
+				gcur.font_s = h;
+				gold.font_n = NULL;
+			}
 			return;
 		}
 		break;
 	}
+
 	// check if already a SVG definition from %%beginsvg
 	if (defs) {
 		s = strstr(defs, op);
@@ -4363,10 +4491,48 @@ translate:
 	ps_error = 1;
 }
 
+/* execute a name */
+static void ps_sym_exec(struct ps_sym_s *sym)
+{
+	if (ps_error)
+		return;
+#if 0
+fprintf(stderr, "%s ", sym->n);
+stack_dump();
+#endif
+	if (sym->e) {				/* user definition */
+		if (++sym->exec > 2) {
+			fprintf(stderr, "svg: Too many recursions of '%s'\n",
+				sym->n);
+			ps_error = 1;
+			return;
+		}
+		if (sym->code)
+			code_exec(sym->code, sym->ncode);
+		else
+			seq_exec(sym->e);
+		sym->exec--;
+		return;
+	}
+	ps_builtin(sym);
+}
+
+static void ps_exec(char *op)
+{
+	if (ps_error)
+		return;
+	if (*op == ' ')	{			/* load */
+		ps_builtin(ps_intern(op + 1));
+		return;
+	}
+	ps_sym_exec(ps_intern(op));
+}
+
 void svg_write(char *buf, int len)
 {
 	int l;
 	struct elt_s *e, *e2;
+	struct ps_sym_s *sym;
 	unsigned char c, *p, *q, *r;
 
 	if (ps_error)
@@ -4395,8 +4561,8 @@ void svg_write(char *buf, int len)
 			if (!e)
 				return;
 			in_cnt++;
-			e->type = STR;
-			e->u.s = strdup(c == '{' ? "{" : "[");
+			e->type = MRK;
+			e->u.v = c;
 			push(e);
 			break;
 		case '}':
@@ -4426,16 +4592,14 @@ void svg_write(char *buf, int len)
 			for (;;) {
 				e2 = stack;
 				stack = stack->next;
-				if (e2->type == STR
-				 && (e2->u.s[0] == '['
-				  || e2->u.s[0] == '{'))
+				if (e2->type == MRK)
 					break;
 				e2->next = e->u.e;
 				e->u.e = e2;
 			}
-			if (e2->u.s[0] != c) {
+			if ((int) e2->u.v != c) {
 				fprintf(stderr, "svg: '%c' found before '%c'\n",
-					e2->u.s[0], c);
+					(int) e2->u.v, c);
 				ps_error = 1;
 				return;
 			}
@@ -4466,7 +4630,7 @@ void svg_write(char *buf, int len)
 						&row, &col, &x, &y);
 					w = h = 6;
 				}
-				fprintf(fout, "<abc type=\"%c\" row=\"%d\" col=\"%d\" x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"%d\"/>\n",
+				svg_printf("<abc type=\"%c\" row=\"%d\" col=\"%d\" x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"%d\"/>\n",
 					type, row, col, gcur.xoffs + x, gcur.yoffs - y - h, w, h);
 				break;
 			}
@@ -4476,16 +4640,49 @@ void svg_write(char *buf, int len)
 				setg(1);
 				if (q[10] == 's') {		/* subtitle */
 					q += 14;
-					fprintf(fout, "<!-- subtitle: %.*s -->\n",
+					svg_printf("<!-- subtitle: %.*s -->\n",
 							(int) (p - q - 1), q);
 					break;
 				}
 				q += 11;
-				fprintf(fout, "<!-- title: %.*s -->\n",
+				svg_printf("<!-- title: %.*s -->\n",
 						(int) (p - q -1), q);
 				break;
 			}
 			break;
+		case SVG_VAL:			/* native value - see putf() */
+			if (len < 3)
+				break;
+			len -= 3;
+			l = ((p[0] & 0x7f) << 14) | ((p[1] & 0x7f) << 7)
+					| (p[2] & 0x7f);
+			p += 3;
+			e = elt_new();
+			if (!e)
+				return;
+			e->type = VAL;
+			e->u.v = (float) (l & 0xfffff) / 10.f;
+			if (l & (1 << 20))
+				e->u.v = -e->u.v;
+			push(e);
+			break;
+		case SVG_OP:			/* drawing operation - see put_op() */
+			if (--len < 0)
+				break;
+			l = *p++ & 0x7f;
+			if (!in_cnt) {
+				ps_sym_exec(op_sym[l]);
+				if (ps_error)
+					return;
+				break;
+			}
+			e = elt_new();
+			if (!e)
+				return;
+			e->type = NAME;
+			e->u.sym = op_sym[l];
+			push(e);
+			break;
 		case '(':
 			q = p - 1;
 			l = 1;
@@ -4543,6 +4740,8 @@ void svg_write(char *buf, int len)
 				case ']':
 				case '%':
 				case '/':
+				case SVG_VAL:
+				case SVG_OP:
 					break;
 				default:
 					continue;
@@ -4570,7 +4769,7 @@ void svg_write(char *buf, int len)
 					i = strtol((char *) q + 3, 0, 16);
 					e->u.v = i;
 				} else {
-					if (sscanf((char *) q, "%f", &v) != 1) {
+					if (!ps_atof((char *) q, &v)) {
 						fprintf(stderr, "svg: Bad numeric value in '%s'\n",
 							buf);
 						v = 0;
@@ -4579,40 +4778,47 @@ void svg_write(char *buf, int len)
 				}
 				*p = c;
 			} else {
-				if (!in_cnt) {
-					if (*q != '/') {	/* operator */
-						c = *p;
-						*p = '\0';
-						ps_exec((char *) q);
-						if (ps_error)
-							return;
-						*p = c;
-						break;
-					}
-				} else if (strncmp((char *) q, "pdfmark", 7) == 0) {
+				if (in_cnt
+				 && strncmp((char *) q, "pdfmark", 7) == 0) {
 					in_cnt--;
 					for (;;) {
 						e = pop(stack->type);
-						if (e->type == STR
-						 && (e->u.s[0] == '['
-						  || e->u.s[0] == '{'))
+						if (e->type == MRK)
 							break;
 						elt_free(e);
 					}
 					elt_free(e);
 					break;
 				}
-				l = p - q;
-				r = malloc(l + 1);
-				memcpy(r, q, l);
-				r[l] = '\0';
-				e = elt_new();
-				if (!e) {
-					free(r);
-					return;
+				if (*q != '/') {	/* operator */
+					c = *p;
+					*p = '\0';
+					sym = ps_intern((char *) q);
+					*p = c;
+					if (!in_cnt) {
+						ps_sym_exec(sym);
+						if (ps_error)
+							return;
+						break;
+					}
+					e = elt_new();
+					if (!e)
+						return;
+					e->type = NAME;
+					e->u.sym = sym;
+				} else {
+					l = p - q;
+					r = malloc(l + 1);
+					memcpy(r, q, l);
+					r[l] = '\0';
+					e = elt_new();
+					if (!e) {
+						free(r);
+						return;
+					}
+					e->type = STR;
+					e->u.s = (char *) r;
 				}
-				e->type = STR;
-				e->u.s = (char *) r;
 			}
 			push(e);
 			break;